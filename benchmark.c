@@ -29,8 +29,14 @@ int main(int argc, char *argv[]) {
 			  set_priority(100-(20+j),pid); // will only matter for PBS, comment it out if not implemented yet (better priorty for more IO intensive jobs)
 		}
 	}
-	for (j = 0; j < number_of_processes + 5; j++) {
-		wait();
+	// Per-process run and wait ticks, to compare schedulers.
+	int pid, wtime, rtime, tw = 0, tr = 0;
+	printf(1, "pid\trtime\twtime\n");
+	while ((pid = waitx(&wtime, &rtime)) > 0) {
+		printf(1, "%d\t%d\t%d\n", pid, rtime, wtime);
+		tw += wtime;
+		tr += rtime;
 	}
+	printf(1, "total\t%d\t%d\n", tr, tw);
 	exit();
 }
@@ -21,15 +21,23 @@
 #include "types.h"
 #include "defs.h"
 #include "param.h"
+#include "mmu.h"
+#include "proc.h"
 #include "spinlock.h"
 #include "sleeplock.h"
 #include "fs.h"
 #include "buf.h"
+#include "iostat.h"
 
 struct {
   struct spinlock lock;
   struct buf buf[NBUF];
 
+  // Statistics for getiostat(), protected by lock.
+  uint hits;
+  uint misses;
+  uint evictions;
+
   // Linked list of all buffers, through prev/next.
   // head.next is most recently used.
   struct buf head;
@@ -69,6 +77,7 @@ bget(uint dev, uint blockno)
   for(b = bcache.head.next; b != &bcache.head; b = b->next){
     if(b->dev == dev && b->blockno == blockno){
       b->refcnt++;
+      bcache.hits++;
       release(&bcache.lock);
       acquiresleep(&b->lock);
       return b;
@@ -80,6 +89,9 @@ bget(uint dev, uint blockno)
   // because log.c has modified it but not yet committed it.
   for(b = bcache.head.prev; b != &bcache.head; b = b->prev){
     if(b->refcnt == 0 && (b->flags & B_DIRTY) == 0) {
+      bcache.misses++;
+      if(b->flags & B_VALID)
+        bcache.evictions++;
       b->dev = dev;
       b->blockno = blockno;
       b->flags = 0;
@@ -101,6 +113,8 @@ bread(uint dev, uint blockno)
   b = bget(dev, blockno);
   if((b->flags & B_VALID) == 0) {
     iderw(b);
+    if(myproc())
+      myproc()->rblocks++;
   }
   return b;
 }
@@ -113,6 +127,8 @@ bwrite(struct buf *b)
     panic("bwrite");
   b->flags |= B_DIRTY;
   iderw(b);
+  if(myproc())
+    myproc()->wblocks++;
 }
 
 // Release a locked buffer.
@@ -139,6 +155,44 @@ brelse(struct buf *b)
   
   release(&bcache.lock);
 }
+
+// Release a locked buffer like brelse, but as the least
+// recently used, so that it is recycled first.  For file data,
+// which the page cache keeps (see readi), so that it does not
+// push the metadata out of the buffer cache.
+void
+bforget(struct buf *b)
+{
+  if(!holdingsleep(&b->lock))
+    panic("bforget");
+
+  releasesleep(&b->lock);
+
+  acquire(&bcache.lock);
+  b->refcnt--;
+  if (b->refcnt == 0) {
+    b->next->prev = b->prev;
+    b->prev->next = b->next;
+    b->next = &bcache.head;
+    b->prev = bcache.head.prev;
+    bcache.head.prev->next = b;
+    bcache.head.prev = b;
+  }
+  release(&bcache.lock);
+}
+
+// Fill in the buffer cache counters of st; clear them if reset.
+void
+bstat(struct iostat *st, int reset)
+{
+  acquire(&bcache.lock);
+  st->hits = bcache.hits;
+  st->misses = bcache.misses;
+  st->evictions = bcache.evictions;
+  if(reset)
+    bcache.hits = bcache.misses = bcache.evictions = 0;
+  release(&bcache.lock);
+}
 //PAGEBREAK!
 // Blank page.
 
@@ -7,6 +7,8 @@ struct buf {
   struct buf *prev; // LRU cache list
   struct buf *next;
   struct buf *qnext; // disk queue
+  uint64 tqueue;     // rdtsc when queued by iderw()
+  uint64 tissue;     // rdtsc when started by idestart()
   uchar data[BSIZE];
 };
 #define B_VALID 0x2  // buffer has been read from disk
@@ -0,0 +1,22 @@
+#include "types.h"
+#include "user.h"
+
+// usage: chrt runtime period deadline cmd args...
+//
+// Runs cmd in the real-time (EDF) class: runtime ticks of CPU
+// in every period ticks, each within deadline ticks of the
+// period's start.
+
+int main(int argc, char **argv) {
+	if (argc < 5) {
+		printf(2, "usage: chrt runtime period deadline cmd args...\n");
+		exit();
+	}
+	if (sched_deadline(atoi(argv[1]), atoi(argv[2]), atoi(argv[3])) < 0) {
+		printf(2, "chrt: parameters rejected\n");
+		exit();
+	}
+	exec(argv[4], argv + 4);
+	printf(2, "chrt: exec %s failed\n", argv[4]);
+	exit();
+}
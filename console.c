@@ -14,6 +14,7 @@
 #include "mmu.h"
 #include "proc.h"
 #include "x86.h"
+#include "poll.h"
 
 static void consputc(int);
 
@@ -184,6 +185,7 @@ struct {
   uint r;  // Read index
   uint w;  // Write index
   uint e;  // Edit index
+  struct waitq wq;  // pollers
 } input;
 
 #define C(x)  ((x)-'@')  // Control-x
@@ -221,6 +223,7 @@ consoleintr(int (*getc)(void))
         if(c == '\n' || c == C('D') || input.e == input.r+INPUT_BUF){
           input.w = input.e;
           wakeup(&input.r);
+          pollwake(&input.wq);
         }
       }
       break;
@@ -233,7 +236,7 @@ consoleintr(int (*getc)(void))
 }
 
 int
-consoleread(struct inode *ip, char *dst, int n)
+consoleread(struct inode *ip, char *dst, int n, int nonblock)
 {
   uint target;
   int c;
@@ -243,11 +246,13 @@ consoleread(struct inode *ip, char *dst, int n)
   acquire(&cons.lock);
   while(n > 0){
     while(input.r == input.w){
-      if(myproc()->killed){
+      if(myproc()->killed || (nonblock && n == target)){
         release(&cons.lock);
         ilock(ip);
         return -1;
       }
+      if(nonblock)
+        goto out;
       sleep(&input.r, &cons.lock);
     }
     c = input.buf[input.r++ % INPUT_BUF];
@@ -264,6 +269,7 @@ consoleread(struct inode *ip, char *dst, int n)
     if(c == '\n')
       break;
   }
+out:
   release(&cons.lock);
   ilock(ip);
 
@@ -285,6 +291,20 @@ consolewrite(struct inode *ip, char *buf, int n)
   return n;
 }
 
+// A read is ready once a whole line (or a ^D) has been typed.
+int
+consolepoll(struct inode *ip, struct poller *pw)
+{
+  int r = POLLOUT;
+
+  acquire(&cons.lock);
+  if(input.r != input.w)
+    r |= POLLIN;
+  pollwait(&input.wq, pw);
+  release(&cons.lock);
+  return r;
+}
+
 void
 consoleinit(void)
 {
@@ -292,6 +312,7 @@ consoleinit(void)
 
   devsw[CONSOLE].write = consolewrite;
   devsw[CONSOLE].read = consoleread;
+  devsw[CONSOLE].poll = consolepoll;
   cons.locking = 1;
 
   ioapicenable(IRQ_KBD, 0);
@@ -0,0 +1,76 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "fcntl.h"
+
+// usage: cp src dst
+//        cp src dir
+//
+// The data is copied inside the kernel with copy_file_range,
+// or with read and write if src is not a regular file.
+
+char buf[512];
+char path[512];
+
+// Copy through user space, for devices.
+int
+slowcopy(int in, int out)
+{
+  int n;
+
+  while((n = read(in, buf, sizeof(buf))) > 0)
+    if(write(out, buf, n) != n)
+      return -1;
+  return n;
+}
+
+int
+main(int argc, char *argv[])
+{
+  struct stat st;
+  char *dst, *p;
+  int in, out, n;
+
+  if(argc != 3){
+    printf(2, "Usage: cp src dst\n");
+    exit();
+  }
+  if((in = open(argv[1], O_RDONLY)) < 0){
+    printf(2, "cp: cannot open %s\n", argv[1]);
+    exit();
+  }
+
+  // Into a directory: dir/basename(src).
+  dst = argv[2];
+  if(stat(dst, &st) >= 0 && st.type == T_DIR){
+    for(p = argv[1] + strlen(argv[1]); p > argv[1] && p[-1] != '/'; p--)
+      ;
+    if(strlen(dst) + 1 + strlen(p) + 1 > sizeof(path)){
+      printf(2, "cp: path too long\n");
+      exit();
+    }
+    strcpy(path, dst);
+    strcpy(path + strlen(path), "/");
+    strcpy(path + strlen(path), p);
+    dst = path;
+  }
+
+  // There is no O_TRUNC.
+  unlink(dst);
+  if((out = open(dst, O_CREATE | O_WRONLY)) < 0){
+    printf(2, "cp: cannot create %s\n", dst);
+    exit();
+  }
+
+  fstat(in, &st);
+  if(st.type == T_FILE){
+    while((n = copy_file_range(in, 0, out, 0, 64*1024, 0)) > 0)
+      ;
+  } else
+    n = slowcopy(in, out);
+  if(n < 0)
+    printf(2, "cp: %s: copy failed\n", argv[1]);
+  close(in);
+  close(out);
+  exit();
+}
@@ -0,0 +1,83 @@
+// Per-CPU time accounting.
+//
+// Each CPU is always in one of the CPU_* states of cpustat.h.
+// trap() and scheduler() call cpuacct() on every transition,
+// which charges the rdtsc cycles since the previous transition
+// to the state being left.  Only the owning CPU writes its
+// entry, with interrupts off, so no lock is needed; a snapshot
+// of another CPU is at most one timer tick stale.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "memlayout.h"
+#include "mmu.h"
+#include "proc.h"
+#include "x86.h"
+#include "spinlock.h"
+#include "sleeplock.h"
+#include "sched.h"
+#include "cpustat.h"
+
+static struct {
+  int state;
+  uint64 stamp;   // rdtsc at the last transition, 0 before the first
+  uint64 time[NCPUSTATE];
+} acct[NCPU];
+
+// Charge this CPU's time since the last call to its current
+// state and switch it to state.  Returns the previous state.
+int
+cpuacct(int state)
+{
+  uint64 now;
+  int old;
+
+  pushcli();
+  now = rdtsc();
+  old = acct[cpuid()].state;
+  if(acct[cpuid()].stamp)
+    acct[cpuid()].time[old] += now - acct[cpuid()].stamp;
+  acct[cpuid()].state = state;
+  acct[cpuid()].stamp = now;
+  popcli();
+  return old;
+}
+
+// Fill st with the time of every CPU and process.
+int
+cpustat(struct sysstat *st)
+{
+  static char *states[] = {
+  [SLEEPING]  "sleeping",
+  [RUNNABLE]  "runnable",
+  [RUNNING]   "running ",
+  [ZOMBIE]    "zombie  "
+  };
+  struct procstat *ps;
+  struct proc *p;
+  int i;
+
+  cpuacct(CPU_KERNEL);
+  st->ncpu = ncpu;
+  for(i = 0; i < ncpu; i++)
+    memmove(st->cpu[i].time, acct[i].time, sizeof(acct[i].time));
+
+  acquire(&ptable.lock);
+  st->tsc = rdtsc();
+  st->nproc = 0;
+  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
+    if(p->state == UNUSED || p->state == EMBRYO)
+      continue;
+    ps = &st->proc[st->nproc++];
+    ps->pid = p->pid;
+    ps->cpu = p->lastcpu;
+    safestrcpy(ps->state, states[p->state], sizeof(ps->state));
+    safestrcpy(ps->name, p->name, sizeof(ps->name));
+    ps->cycles = p->cputime;
+    if(p->state == RUNNING && st->tsc > p->tdispatch)
+      ps->cycles += st->tsc - p->tdispatch;
+  }
+  release(&ptable.lock);
+  return 0;
+}
@@ -0,0 +1,29 @@
+// What a CPU's time is charged to (cpustat.c).
+#define CPU_USER   0  // running user code
+#define CPU_KERNEL 1  // in the kernel: syscalls, faults, scheduling
+#define CPU_IDLE   2  // in the scheduler with nothing to run
+#define CPU_IRQ    3  // handling a device, timer or IPI interrupt
+#define NCPUSTATE  4
+
+struct cpustat {
+	uint64 time[NCPUSTATE];  // rdtsc cycles spent in each state
+};
+
+struct procstat {
+	int pid;
+	int cpu;          // CPU it is running on or last ran on, -1 if none
+	char state[9];    // as in struct pinfo
+	char name[16];
+	uint64 cycles;    // rdtsc cycles it has been running on a CPU
+};
+
+// Snapshot returned by cpustat.  CPU% over an interval is the
+// difference of two snapshots' cycles over the difference of
+// their tsc.
+struct sysstat {
+	uint64 tsc;       // rdtsc when the snapshot was taken
+	int ncpu;
+	struct cpustat cpu[NCPU];
+	int nproc;
+	struct procstat proc[NPROC];
+};
@@ -1,21 +1,37 @@
 struct buf;
 struct context;
+struct fdtable;
 struct file;
 struct inode;
+struct iovec;
 struct pipe;
+struct poller;
+struct pollfd;
 struct proc;
 struct rtcdate;
 struct spinlock;
+struct spawnact;
 struct sleeplock;
 struct stat;
 struct superblock;
 struct pinfo;
+struct schedparam;
+struct iostat;
+struct schedevent;
+struct rusage;
+struct sysstat;
+struct profsample;
+struct trapframe;
+struct lockclass;
+struct lockinfo;
 
 // bio.c
 void            binit(void);
 struct buf*     bread(uint, uint);
 void            brelse(struct buf*);
+void            bforget(struct buf*);
 void            bwrite(struct buf*);
+void            bstat(struct iostat*, int);
 
 // console.c
 void            consoleinit(void);
@@ -23,20 +39,37 @@ void            cprintf(char*, ...);
 void            consoleintr(int(*)(void));
 void            panic(char*) __attribute__((noreturn));
 
+// cpustat.c
+int             cpuacct(int);
+int             cpustat(struct sysstat*);
+
 // exec.c
 int             exec(char*, char**);
+int             loaduser(char*, char**, pde_t**, uint*, uint*, uint*);
+char*           progname(char*);
 
 // file.c
+struct file*    fdget(struct fdtable*, int);
+struct fdtable* fdtalloc(void);
+struct fdtable* fdtcopy(struct fdtable*);
+struct fdtable* fdtdup(struct fdtable*);
+void            fdtput(struct fdtable*);
+struct fdtable* fdtunshare(struct fdtable*);
 struct file*    filealloc(void);
 void            fileclose(struct file*);
 struct file*    filedup(struct file*);
 void            fileinit(void);
 int             fileread(struct file*, char*, int n);
+int             filereadv(struct file*, struct iovec*, int, uint*);
+int             filecopy(struct file*, uint*, struct file*, uint*, uint);
+int             filepoll(struct file*, struct poller*);
 int             filestat(struct file*, struct stat*);
 int             filewrite(struct file*, char*, int n);
+int             filewritev(struct file*, struct iovec*, int, uint*);
 
 // fs.c
 void            readsb(int dev, struct superblock *sb);
+int             copyi(struct inode*, uint, struct inode*, uint, uint);
 int             dirlink(struct inode*, char*, uint);
 struct inode*   dirlookup(struct inode*, char*, uint*);
 struct inode*   ialloc(uint, short);
@@ -50,14 +83,23 @@ void            iupdate(struct inode*);
 int             namecmp(const char*, const char*);
 struct inode*   namei(char*);
 struct inode*   nameiparent(char*, char*);
+char*           pcref(struct inode*, uint);
+int             pcreclaim(void);
+void            pcstat(struct iostat*, int);
 int             readi(struct inode*, char*, uint, uint);
 void            stati(struct inode*, struct stat*);
 int             writei(struct inode*, char*, uint, uint);
 
+// futex.c
+void            futexinit(void);
+int             futex_wait(uint, uint, int);
+int             futex_wake(uint, int);
+
 // ide.c
 void            ideinit(void);
 void            ideintr(void);
 void            iderw(struct buf*);
+void            idestats(struct iostat*, int);
 
 // ioapic.c
 void            ioapicenable(int irq, int cpu);
@@ -66,6 +108,8 @@ void            ioapicinit(void);
 
 // kalloc.c
 char*           kalloc(void);
+void            kref(char*);
+int             krefs(char*);
 void            kfree(char*);
 void            kinit1(void*, void*);
 void            kinit2(void*, void*);
@@ -80,6 +124,7 @@ extern volatile uint*    lapic;
 void            lapiceoi(void);
 void            lapicinit(void);
 void            lapicstartap(uchar, uint);
+void            lapicipi(int, int);
 void            microdelay(int);
 
 // log.c
@@ -88,6 +133,16 @@ void            log_write(struct buf*);
 void            begin_op();
 void            end_op();
 
+// mmap.c
+void            mmapinit(void);
+int             mmap(uint, int, int, struct file*, uint);
+int             munmap(uint, uint);
+int             mmapfault(uint, int);
+int             mmapprefault(uint, uint);
+uint            mmapend(pde_t*, uint);
+int             mmapfork(pde_t*, pde_t*);
+void            mmapfree(pde_t*);
+
 // mp.c
 extern int      ismp;
 void            mpinit(void);
@@ -99,17 +154,36 @@ void            picinit(void);
 // pipe.c
 int             pipealloc(struct file**, struct file**);
 void            pipeclose(struct pipe*, int);
-int             piperead(struct pipe*, char*, int);
-int             pipewrite(struct pipe*, char*, int);
+int             pipepoll(struct pipe*, struct poller*);
+int             piperead(struct pipe*, struct iovec*, int, int);
+int             pipewrite(struct pipe*, struct iovec*, int, int);
+
+// poll.c
+struct waitq;
+void            pollinit(void);
+int             poll(struct pollfd*, int, int);
+void            pollwait(struct waitq*, struct poller*);
+void            pollwake(struct waitq*);
+
+// prof.c
+void            profinit(void);
+void            profsample(struct trapframe*);
+int             profctl(int);
+int             profread(struct profsample*, int);
 
 //PAGEBREAK: 16
 // proc.c
+int             clone(void(*)(void*, void*), void*, void*, void*);
 int             cpuid(void);
+void            execvm(pde_t*, uint);
 void            exit(void);
 int             fork(void);
 int             growproc(int);
 void            update_proctime(void);
+int             join(void**);
 int             kill(int);
+struct proc*    kthread(char*, void(*)(void), pde_t*);
+int             spawn(char*, char**, struct spawnact*, int);
 struct cpu*     mycpu(void);
 struct proc*    myproc();
 void            pinit(void);
@@ -119,13 +193,33 @@ void            sched(void);
 int             set_prioritiy(int, int);
 void            setproc(struct proc*);
 void            sleep(void*, struct spinlock*);
+int             sleeptimed(void*, struct spinlock*, uint);
 void            userinit(void);
+int             uvmpin(uint, uint);
+int             uvmpinned(pde_t*, uint, uint);
+void            uvmunpin(void);
 int             wait(void);
 int             waitx(int*, int*);
+int             wait4(int, struct rusage*);
 void            wakeup(void*);
+int             wakeupn(void*, int);
+void            wakeup_timeouts(void);
 void            yield(void);
 int             get_pinfos(struct pinfo*);
 
+// sched.c
+struct proc*    sched_pick(struct cpu*);
+int             sched_setaffinity(int, uint);
+int             sched_getaffinity(int);
+void            sched_put(struct proc*);
+void            sched_wakeup(struct proc*);
+void            sched_inherit(struct proc*);
+int             sched_tracearg(struct proc*);
+int             sched_tick(void);
+void            sched_clock(void);
+int             sched_deadline(int, int, int);
+int             schedctl(int, struct schedparam*);
+
 // swtch.S
 void            swtch(struct context**, struct context*);
 
@@ -137,6 +231,19 @@ void            initlock(struct spinlock*, char*);
 void            release(struct spinlock*);
 void            pushcli(void);
 void            popcli(void);
+struct lockclass* lockclass(char*, int);
+void            lockstat_acquire(struct lockclass*, int, uint64);
+void            lockstat_release(struct lockclass*, uint64);
+int             get_lockstat(struct lockinfo*, int, int);
+
+// shm.c
+void            shminit(void);
+int             shmget(int, uint);
+int             shmat(int);
+int             shmdt(uint);
+int             shmfork(pde_t*, pde_t*);
+void            shmfree(pde_t*);
+uint            shmend(pde_t*, uint);
 
 // sleeplock.c
 void            acquiresleep(struct sleeplock*);
@@ -156,10 +263,18 @@ char*           strncpy(char*, const char*, int);
 // syscall.c
 int             argint(int, int*);
 int             argptr(int, char**, int);
-int             argstr(int, char**);
+int             argstr(int, char*, int);
+int             checkptr(uint, int);
 int             fetchint(uint, int*);
-int             fetchstr(uint, char**);
+int             fetchstr(uint, char*, int);
 void            syscall(void);
+uint            uvaend(uint);
+
+// sysfile.c
+int             fdclose(int);
+int             fdopen(char*, int);
+void            fdrelease(void);
+struct file*    fileopen(char*, int);
 
 // timer.c
 void            timerinit(void);
@@ -170,6 +285,19 @@ extern uint     ticks;
 void            tvinit(void);
 extern struct spinlock tickslock;
 
+// trace.c
+void            traceinit(void);
+void            schedtrace(int, struct proc*, int);
+int             tracectl(int);
+int             traceread(struct schedevent*, int);
+
+// uring.c
+struct uring;
+void            uringinit(void);
+int             uringsetup(struct uring*);
+int             uringenter(int, int);
+void            uringexit(struct proc*);
+
 // uart.c
 void            uartinit(void);
 void            uartintr(void);
@@ -182,11 +310,17 @@ pde_t*          setupkvm(void);
 char*           uva2ka(pde_t*, char*);
 int             allocuvm(pde_t*, uint, uint);
 int             deallocuvm(pde_t*, uint, uint);
+int             shrinkuvm(pde_t*, uint, uint);
 void            freevm(pde_t*);
 void            inituvm(pde_t*, char*, uint);
 int             loaduvm(pde_t*, char*, struct inode*, uint, uint);
 pde_t*          copyuvm(pde_t*, uint);
 void            switchuvm(struct proc*);
+void            tlbshootdown(pde_t*);
+pte_t*          walkpgdir(pde_t*, const void*, int);
+int             mappages(pde_t*, void*, uint, uint, int);
+int             shmmap(pde_t*, uint, char**, int);
+void            shmunmap(pde_t*, uint, int);
 void            switchkvm(void);
 int             copyout(pde_t*, uint, void*, uint);
 void            clearpteu(pde_t *pgdir, char *uva);
@@ -194,4 +328,3 @@ void            clearpteu(pde_t *pgdir, char *uva);
 // number of elements in fixed-size array
 #define NELEM(x) (sizeof(x)/sizeof((x)[0]))
 
-//#define LOGS
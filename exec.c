@@ -7,17 +7,19 @@
 #include "x86.h"
 #include "elf.h"
 
+// Build a new user address space for the program in the ELF
+// file path, with argv (in the current address space) on its
+// stack.  Sets *pgdirp, its size *szp, and the initial *eipp and
+// *espp.  Used by exec() and spawn().
 int
-exec(char *path, char **argv)
+loaduser(char *path, char **argv, pde_t **pgdirp, uint *szp, uint *eipp, uint *espp)
 {
-  char *s, *last;
   int i, off;
   uint argc, sz, sp, ustack[3+MAXARG+1];
   struct elfhdr elf;
   struct inode *ip;
   struct proghdr ph;
-  pde_t *pgdir, *oldpgdir;
-  struct proc *curproc = myproc();
+  pde_t *pgdir;
 
   begin_op();
 
@@ -87,28 +89,60 @@ exec(char *path, char **argv)
   if(copyout(pgdir, sp, ustack, (3+argc+1)*4) < 0)
     goto bad;
 
-  // Save program name for debugging.
-  for(last=s=path; *s; s++)
-    if(*s == '/')
-      last = s+1;
-  safestrcpy(curproc->name, last, sizeof(curproc->name));
-
-  // Commit to the user image.
-  oldpgdir = curproc->pgdir;
-  curproc->pgdir = pgdir;
-  curproc->sz = sz;
-  curproc->tf->eip = elf.entry;  // main
-  curproc->tf->esp = sp;
-  switchuvm(curproc);
-  freevm(oldpgdir);
+  *pgdirp = pgdir;
+  *szp = sz;
+  *eipp = elf.entry;  // main
+  *espp = sp;
   return 0;
 
  bad:
-  if(pgdir)
-    freevm(pgdir);
   if(ip){
     iunlockput(ip);
     end_op();
   }
+  if(pgdir)
+    freevm(pgdir);
   return -1;
 }
+
+// The last element of path, as a process name.
+char*
+progname(char *path)
+{
+  char *s, *last;
+
+  for(last=s=path; *s; s++)
+    if(*s == '/')
+      last = s+1;
+  return last;
+}
+
+int
+exec(char *path, char **argv)
+{
+  uint sz, eip, sp;
+  pde_t *pgdir;
+  struct fdtable *fdt;
+  struct proc *curproc = myproc();
+
+  if(loaduser(path, argv, &pgdir, &sz, &eip, &sp) < 0)
+    return -1;
+
+  // The new program does not share open files with the threads
+  // left behind.
+  if((fdt = fdtunshare(curproc->fdt)) == 0){
+    freevm(pgdir);
+    return -1;
+  }
+  curproc->fdt = fdt;
+
+  // Save program name for debugging.
+  safestrcpy(curproc->name, progname(path), sizeof(curproc->name));
+
+  // Commit to the user image.
+  uringexit(curproc);
+  curproc->tf->eip = eip;
+  curproc->tf->esp = sp;
+  execvm(pgdir, sz);
+  return 0;
+}
@@ -2,3 +2,8 @@
 #define O_WRONLY  0x001
 #define O_RDWR    0x002
 #define O_CREATE  0x200
+#define O_NONBLOCK 0x800  // fail reads and writes that would wait
+
+// fcntl() commands.
+#define F_GETFL   1  // returns the open mode and O_NONBLOCK
+#define F_SETFL   2  // sets O_NONBLOCK; other bits are ignored
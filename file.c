@@ -9,6 +9,9 @@
 #include "spinlock.h"
 #include "sleeplock.h"
 #include "file.h"
+#include "uio.h"
+#include "stat.h"
+#include "poll.h"
 
 struct devsw devsw[NDEV];
 struct {
@@ -16,10 +19,117 @@ struct {
   struct file file[NFILE];
 } ftable;
 
+static struct {
+  struct spinlock lock;  // protects ref of the tables
+  struct fdtable t[NPROC];
+} fdtables;
+
 void
 fileinit(void)
 {
+  struct fdtable *t;
+
   initlock(&ftable.lock, "ftable");
+  initlock(&fdtables.lock, "fdtables");
+  for(t = fdtables.t; t < &fdtables.t[NPROC]; t++)
+    initlock(&t->lock, "fdtable");
+}
+
+// Allocate an empty file table.
+struct fdtable*
+fdtalloc(void)
+{
+  struct fdtable *t;
+
+  acquire(&fdtables.lock);
+  for(t = fdtables.t; t < &fdtables.t[NPROC]; t++){
+    if(t->ref == 0){
+      t->ref = 1;
+      release(&fdtables.lock);
+      return t;
+    }
+  }
+  release(&fdtables.lock);
+  return 0;
+}
+
+// A new file table with the same files as t (for fork).
+struct fdtable*
+fdtcopy(struct fdtable *t)
+{
+  struct fdtable *nt;
+  int i;
+
+  if((nt = fdtalloc()) == 0)
+    return 0;
+  acquire(&t->lock);
+  for(i = 0; i < NOFILE; i++)
+    if(t->ofile[i])
+      nt->ofile[i] = filedup(t->ofile[i]);
+  release(&t->lock);
+  return nt;
+}
+
+// Another reference to t (for clone).
+struct fdtable*
+fdtdup(struct fdtable *t)
+{
+  acquire(&fdtables.lock);
+  t->ref++;
+  release(&fdtables.lock);
+  return t;
+}
+
+// Drop a reference to t, closing its files with the last.
+void
+fdtput(struct fdtable *t)
+{
+  struct file *f[NOFILE];
+  int i;
+
+  acquire(&fdtables.lock);
+  if(--t->ref > 0){
+    release(&fdtables.lock);
+    return;
+  }
+  memmove(f, t->ofile, sizeof(f));
+  memset(t->ofile, 0, sizeof(t->ofile));
+  release(&fdtables.lock);
+  for(i = 0; i < NOFILE; i++)
+    if(f[i])
+      fileclose(f[i]);
+}
+
+// A table of its own for the holder of a reference to t (for
+// exec): t itself if nobody else uses it, else a copy, which
+// takes the place of the reference.  Returns 0, keeping the
+// reference, if there is no table free.
+struct fdtable*
+fdtunshare(struct fdtable *t)
+{
+  struct fdtable *nt;
+
+  if(t->ref == 1)
+    return t;
+  if((nt = fdtcopy(t)) != 0)
+    fdtput(t);
+  return nt;
+}
+
+// The file open on descriptor fd in t, with a reference of its
+// own for the caller to fileclose(), or 0.
+struct file*
+fdget(struct fdtable *t, int fd)
+{
+  struct file *f = 0;
+
+  if(fd < 0 || fd >= NOFILE)
+    return 0;
+  acquire(&t->lock);
+  if(t->ofile[fd])
+    f = filedup(t->ofile[fd]);
+  release(&t->lock);
+  return f;
 }
 
 // Allocate a file structure.
@@ -32,6 +142,7 @@ filealloc(void)
   for(f = ftable.file; f < ftable.file + NFILE; f++){
     if(f->ref == 0){
       f->ref = 1;
+      f->nonblock = 0;
       release(&ftable.lock);
       return f;
     }
@@ -92,37 +203,180 @@ filestat(struct file *f, struct stat *st)
   return -1;
 }
 
+// Read from device ip, which is locked, failing rather than
+// waiting if nonblock.
+static int
+devread(struct inode *ip, char *dst, int n, int nonblock)
+{
+  if(ip->major < 0 || ip->major >= NDEV || !devsw[ip->major].read)
+    return -1;
+  return devsw[ip->major].read(ip, dst, n, nonblock);
+}
+
 // Read from file f.
 int
 fileread(struct file *f, char *addr, int n)
 {
-  int r;
+  struct iovec iov;
+
+  iov.iov_base = addr;
+  iov.iov_len = n;
+  return filereadv(f, &iov, 1, 0);
+}
+
+// Read from file f into the n buffers of iov, at *off, or at
+// f->off if off is 0 and then advance it.  A short read ends it.
+// The whole read is one ilock().  Pipes have no offsets.
+int
+filereadv(struct file *f, struct iovec *iov, int n, uint *off)
+{
+  uint o;
+  int i, r = 0, tot = 0;
 
   if(f->readable == 0)
     return -1;
   if(f->type == FD_PIPE)
-    return piperead(f->pipe, addr, n);
+    return off ? -1 : piperead(f->pipe, iov, n, f->nonblock);
   if(f->type == FD_INODE){
     ilock(f->ip);
-    if((r = readi(f->ip, addr, f->off, n)) > 0)
-      f->off += r;
+    o = off ? *off : f->off;
+    for(i = 0; i < n; i++){
+      if(f->ip->type == T_DEV)
+        r = devread(f->ip, iov[i].iov_base, iov[i].iov_len, f->nonblock);
+      else
+        r = readi(f->ip, iov[i].iov_base, o, iov[i].iov_len);
+      if(r < 0)
+        break;
+      o += r;
+      tot += r;
+      if(r < iov[i].iov_len)
+        break;
+    }
+    if(off == 0)
+      f->off = o;
     iunlock(f->ip);
-    return r;
+    return r < 0 && tot == 0 ? -1 : tot;
   }
   panic("fileread");
 }
 
+// Lock inodes a and b, in inode number order so that two
+// copies in opposite directions cannot deadlock.
+static void
+ilock2(struct inode *a, struct inode *b)
+{
+  if(a == b){
+    ilock(a);
+  } else if(a->inum < b->inum){
+    ilock(a);
+    ilock(b);
+  } else {
+    ilock(b);
+    ilock(a);
+  }
+}
+
+static void
+iunlock2(struct inode *a, struct inode *b)
+{
+  iunlock(a);
+  if(b != a)
+    iunlock(b);
+}
+
+// Copy n bytes from file in to file out inside the kernel,
+// reading at *inoff and writing at *outoff, or at the file
+// offsets where those are 0; the offsets used advance.  Each
+// transaction copies as much as the log can take.  The ranges
+// may not overlap if in and out are the same file.  Returns the
+// number of bytes copied, short at the end of in, or -1.
+int
+filecopy(struct file *in, uint *inoff, struct file *out, uint *outoff, uint n)
+{
+  // Blocks of out a transaction can write, after the i-node,
+  // the indirect block and two allocation bitmap blocks.
+  // Chunks end on a block boundary of out, so there is no slop.
+  uint max = (MAXOPBLOCKS-1-1-2) * BSIZE;
+  uint *ip, *op, n1, tot = 0;
+  int r = 0;
+
+  if(in->readable == 0 || out->writable == 0)
+    return -1;
+  if(in->type != FD_INODE || out->type != FD_INODE)
+    return -1;
+  ip = inoff ? inoff : &in->off;
+  op = outoff ? outoff : &out->off;
+  if(in->ip == out->ip && *ip < *op + n && *op < *ip + n)
+    return -1;
+
+  while(tot < n){
+    begin_op();
+    ilock2(in->ip, out->ip);
+    n1 = max - *op % BSIZE;
+    if(n1 > n - tot)
+      n1 = n - tot;
+    if((r = copyi(out->ip, *op, in->ip, *ip, n1)) > 0){
+      *ip += r;
+      *op += r;
+      tot += r;
+    }
+    iunlock2(in->ip, out->ip);
+    end_op();
+    if(r != n1)
+      break;
+  }
+  return r < 0 && tot == 0 ? -1 : tot;
+}
+
+// What f is ready for, as POLL* bits, for poll(); puts pw, if
+// not 0, on the wait queue that will see that change.  Other
+// than pipes and devices with a poll function, files are
+// always ready.
+int
+filepoll(struct file *f, struct poller *pw)
+{
+  struct inode *ip = f->ip;
+  int r;
+
+  if(f->type == FD_PIPE)
+    r = pipepoll(f->pipe, pw);
+  else if(f->type == FD_INODE && ip->type == T_DEV &&
+          ip->major >= 0 && ip->major < NDEV && devsw[ip->major].poll)
+    r = devsw[ip->major].poll(ip, pw);
+  else
+    r = POLLIN | POLLOUT;
+  if(!f->readable)
+    r &= ~(POLLIN | POLLHUP);
+  if(!f->writable)
+    r &= ~(POLLOUT | POLLERR);
+  return r;
+}
+
 //PAGEBREAK!
 // Write to file f.
 int
 filewrite(struct file *f, char *addr, int n)
 {
-  int r;
+  struct iovec iov;
+
+  iov.iov_base = addr;
+  iov.iov_len = n;
+  return filewritev(f, &iov, 1, 0);
+}
+
+// Write the n buffers of iov to file f, at *off, or at f->off
+// if off is 0 and then advance it.  Returns the number of bytes
+// written, or -1 if not all of them were.
+int
+filewritev(struct file *f, struct iovec *iov, int n, uint *off)
+{
+  uint o, n1, done, room;
+  int r = 0, i, tot = 0;
 
   if(f->writable == 0)
     return -1;
   if(f->type == FD_PIPE)
-    return pipewrite(f->pipe, addr, n);
+    return off ? -1 : pipewrite(f->pipe, iov, n, f->nonblock);
   if(f->type == FD_INODE){
     // write a few blocks at a time to avoid exceeding
     // the maximum log transaction size, including
@@ -130,27 +384,38 @@ filewrite(struct file *f, char *addr, int n)
     // and 2 blocks of slop for non-aligned writes.
     // this really belongs lower down, since writei()
     // might be writing a device like the console.
+    // The buffers go to consecutive bytes of the file, so
+    // as many of them fit in a transaction as fit in one
+    // write.
     int max = ((MAXOPBLOCKS-1-1-2) / 2) * 512;
-    int i = 0;
-    while(i < n){
-      int n1 = n - i;
-      if(n1 > max)
-        n1 = max;
-
+    i = 0;
+    done = 0;
+    while(i < n && r >= 0){
       begin_op();
       ilock(f->ip);
-      if ((r = writei(f->ip, addr + i, f->off, n1)) > 0)
-        f->off += r;
+      o = off ? *off + tot : f->off;
+      for(room = max; i < n && room > 0; room -= n1){
+        n1 = iov[i].iov_len - done;
+        if(n1 > room)
+          n1 = room;
+        if((r = writei(f->ip, (char*)iov[i].iov_base + done, o, n1)) < 0)
+          break;
+        if(r != n1)
+          panic("short filewrite");
+        o += r;
+        tot += r;
+        done += r;
+        if(done == iov[i].iov_len){
+          i++;
+          done = 0;
+        }
+      }
+      if(off == 0)
+        f->off = o;
       iunlock(f->ip);
       end_op();
-
-      if(r < 0)
-        break;
-      if(r != n1)
-        panic("short filewrite");
-      i += r;
     }
-    return i == n ? n : -1;
+    return r < 0 ? -1 : tot;
   }
   panic("filewrite");
 }
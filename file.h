@@ -3,11 +3,21 @@ struct file {
   int ref; // reference count
   char readable;
   char writable;
+  char nonblock;  // O_NONBLOCK
   struct pipe *pipe;
   struct inode *ip;
   uint off;
 };
 
+// The open files of a process, shared by its threads.
+struct fdtable {
+  struct spinlock lock;        // protects ofile[]
+  int ref;                     // processes using it, 0 if free
+  struct file *ofile[NOFILE];
+};
+
+
+#define NFILEPAGES ((MAXFILE*BSIZE + 4096-1) / 4096)  // 4KB pages in the largest file
 
 // in-memory copy of an inode
 struct inode {
@@ -23,13 +33,33 @@ struct inode {
   short nlink;
   uint size;
   uint addrs[NDIRECT+1];
+
+  char *pages[NFILEPAGES];  // page cache of T_FILE data, see readi
+};
+
+// The processes in poll() waiting for something to change on a
+// pipe or a device (poll.c).  Its owner calls pollwake() on
+// every change.
+struct waitq {
+  struct poller *w[NPOLLER];
+};
+
+// A process in poll() and the wait queues it is on.
+struct poller {
+  int woken;
+  int full;       // a wait queue had no room for it
+  int nq;
+  struct waitq *q[NOFILE];
 };
 
 // table mapping major device number to
-// device functions
+// device functions.  read fails rather than wait if its last
+// argument is set; poll returns POLL* bits and puts a poller,
+// if given, on the device's wait queue.
 struct devsw {
-  int (*read)(struct inode*, char*, int);
+  int (*read)(struct inode*, char*, int, int);
   int (*write)(struct inode*, char*, int);
+  int (*poll)(struct inode*, struct poller*);
 };
 
 extern struct devsw devsw[];
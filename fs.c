@@ -20,9 +20,11 @@
 #include "fs.h"
 #include "buf.h"
 #include "file.h"
+#include "iostat.h"
 
 #define min(a, b) ((a) < (b) ? (a) : (b))
 static void itrunc(struct inode*);
+static int pcdrop(struct inode*, int);
 // there should be one superblock per disk device, but we run with
 // only one device
 struct superblock sb; 
@@ -124,7 +126,9 @@ bfree(int dev, uint b)
 //   the number of in-memory pointers to the entry (open
 //   files and current directories). iget() finds or
 //   creates a cache entry and increments its ref; iput()
-//   decrements ref.
+//   decrements ref.  A free entry that is still valid
+//   keeps its inode, and its cached pages, until iget()
+//   needs it for another one.
 //
 // * Valid: the information (type, size, &c) in an inode
 //   cache entry is only correct when ip->valid is 1.
@@ -168,12 +172,24 @@ struct {
   struct inode inode[NINODE];
 } icache;
 
+// The page cache (see readi).
+static struct {
+  struct spinlock lock;
+
+  // Statistics for getiostat(), protected by lock.
+  uint hits;
+  uint misses;
+  uint reclaimed;
+  uint npages;
+} pcache;
+
 void
 iinit(int dev)
 {
   int i = 0;
   
   initlock(&icache.lock, "icache");
+  initlock(&pcache.lock, "pcache");
   for(i = 0; i < NINODE; i++) {
     initsleeplock(&icache.inode[i].lock, "inode");
   }
@@ -245,15 +261,17 @@ iget(uint dev, uint inum)
 
   acquire(&icache.lock);
 
-  // Is the inode already cached?
+  // Is the inode already cached?  Free entries count if they
+  // are still valid: nothing can have changed the inode since.
   empty = 0;
   for(ip = &icache.inode[0]; ip < &icache.inode[NINODE]; ip++){
-    if(ip->ref > 0 && ip->dev == dev && ip->inum == inum){
+    if((ip->ref > 0 || ip->valid) && ip->dev == dev && ip->inum == inum){
       ip->ref++;
       release(&icache.lock);
       return ip;
     }
-    if(empty == 0 && ip->ref == 0)    // Remember empty slot.
+    // Remember empty slot, preferably one that holds nothing.
+    if(ip->ref == 0 && (empty == 0 || (empty->valid && !ip->valid)))
       empty = ip;
   }
 
@@ -262,6 +280,7 @@ iget(uint dev, uint inum)
     panic("iget: no inodes");
 
   ip = empty;
+  pcdrop(ip, 1);
   ip->dev = dev;
   ip->inum = inum;
   ip->ref = 1;
@@ -430,6 +449,7 @@ itrunc(struct inode *ip)
     ip->addrs[NDIRECT] = 0;
   }
 
+  pcdrop(ip, 1);
   ip->size = 0;
   iupdate(ip);
 }
@@ -446,6 +466,135 @@ stati(struct inode *ip, struct stat *st)
   st->size = ip->size;
 }
 
+//PAGEBREAK!
+// Page cache
+//
+// The data of T_FILE inodes is cached in whole pages, in
+// ip->pages[] indexed by file offset, so that it does not compete
+// with the metadata for the NBUF buffers.  Pages are filled by
+// readi() and kept up to date by writei(), which still writes
+// every block through the buffer cache and the log.  They stay
+// cached while the inode does, even if nobody has it open, and
+// kalloc() takes them back through pcreclaim() when it runs out
+// of memory.  ip->pages[] is protected by ip->lock.
+
+// Return page pn of ip, reading it in if it is not cached, or 0
+// if there is no memory for it.  Caller must hold ip->lock, and
+// the page must start within the file.
+static char*
+pcget(struct inode *ip, uint pn)
+{
+  struct buf *bp;
+  char *pg;
+  uint off;
+
+  if((pg = ip->pages[pn]) != 0){
+    acquire(&pcache.lock);
+    pcache.hits++;
+    release(&pcache.lock);
+    return pg;
+  }
+  if((pg = kalloc()) == 0)
+    return 0;
+  for(off = 0; off < PGSIZE; off += BSIZE){
+    if(pn*PGSIZE + off >= ip->size){
+      memset(pg + off, 0, PGSIZE - off);
+      break;
+    }
+    bp = bread(ip->dev, bmap(ip, (pn*PGSIZE + off) / BSIZE));
+    memmove(pg + off, bp->data, BSIZE);
+    bforget(bp);
+  }
+  ip->pages[pn] = pg;
+  acquire(&pcache.lock);
+  pcache.misses++;
+  pcache.npages++;
+  release(&pcache.lock);
+  return pg;
+}
+
+// Return the cached page of ip at page-aligned offset off with a
+// reference for the caller to kfree(), for mapping it (mmap.c).
+// Returns 0 past the end of the file or if there is no memory.
+// Caller must hold ip->lock.
+char*
+pcref(struct inode *ip, uint off)
+{
+  char *pg;
+
+  if(ip->type != T_FILE || off >= ip->size || (pg = pcget(ip, off/PGSIZE)) == 0)
+    return 0;
+  kref(pg);
+  return pg;
+}
+
+// Drop the cached pages of ip, or, unless all, those that are
+// not also mapped by a process.  Returns how many were dropped.
+// Caller must hold ip->lock or otherwise own ip.
+static int
+pcdrop(struct inode *ip, int all)
+{
+  int i, n = 0;
+
+  for(i = 0; i < NFILEPAGES; i++){
+    if(ip->pages[i] == 0 || (!all && krefs(ip->pages[i]) > 1))
+      continue;
+    kfree(ip->pages[i]);
+    ip->pages[i] = 0;
+    n++;
+  }
+  if(n > 0){
+    acquire(&pcache.lock);
+    pcache.npages -= n;
+    release(&pcache.lock);
+  }
+  return n;
+}
+
+// Give cached pages back to kalloc(): those of inodes nobody has
+// open first, then those of any inode that is not locked, which
+// is checked under the sleep-lock's spin-lock so that nobody can
+// take it meanwhile.  Called from kalloc(), so it must not sleep.
+// Returns how many pages were freed.
+int
+pcreclaim(void)
+{
+  struct inode *ip;
+  int pass, n = 0;
+
+  acquire(&icache.lock);
+  for(pass = 0; pass < 2 && n == 0; pass++){
+    for(ip = &icache.inode[0]; ip < &icache.inode[NINODE]; ip++){
+      if(pass == 0 && ip->ref > 0)
+        continue;
+      acquire(&ip->lock.lk);
+      if(!ip->lock.locked)
+        n += pcdrop(ip, 0);
+      release(&ip->lock.lk);
+    }
+  }
+  release(&icache.lock);
+
+  acquire(&pcache.lock);
+  pcache.reclaimed += n;
+  release(&pcache.lock);
+  return n;
+}
+
+// Fill in the page cache counters of st; clear them if reset.
+void
+pcstat(struct iostat *st, int reset)
+{
+  acquire(&pcache.lock);
+  st->phits = pcache.hits;
+  st->pmisses = pcache.misses;
+  st->preclaimed = pcache.reclaimed;
+  st->ppages = pcache.npages;
+  if(reset)
+    pcache.hits = pcache.misses = pcache.reclaimed = 0;
+  release(&pcache.lock);
+}
+
 //PAGEBREAK!
 // Read data from inode.
 // Caller must hold ip->lock.
@@ -454,11 +603,12 @@ readi(struct inode *ip, char *dst, uint off, uint n)
 {
   uint tot, m;
   struct buf *bp;
+  char *pg;
 
   if(ip->type == T_DEV){
     if(ip->major < 0 || ip->major >= NDEV || !devsw[ip->major].read)
       return -1;
-    return devsw[ip->major].read(ip, dst, n);
+    return devsw[ip->major].read(ip, dst, n, 0);
   }
 
   if(off > ip->size || off + n < off)
@@ -467,6 +617,11 @@ readi(struct inode *ip, char *dst, uint off, uint n)
     n = ip->size - off;
 
   for(tot=0; tot<n; tot+=m, off+=m, dst+=m){
+    if(ip->type == T_FILE && (pg = pcget(ip, off/PGSIZE)) != 0){
+      m = min(n - tot, PGSIZE - off%PGSIZE);
+      memmove(dst, pg + off%PGSIZE, m);
+      continue;
+    }
     bp = bread(ip->dev, bmap(ip, off/BSIZE));
     m = min(n - tot, BSIZE - off%BSIZE);
     memmove(dst, bp->data + off%BSIZE, m);
@@ -500,7 +655,12 @@ writei(struct inode *ip, char *src, uint off, uint n)
     m = min(n - tot, BSIZE - off%BSIZE);
     memmove(bp->data + off%BSIZE, src, m);
     log_write(bp);
-    brelse(bp);
+    if(ip->type == T_FILE){
+      if(ip->pages[off/PGSIZE])
+        memmove(ip->pages[off/PGSIZE] + off%PGSIZE, src, m);
+      bforget(bp);
+    } else
+      brelse(bp);
   }
 
   if(n > 0 && off > ip->size){
@@ -510,6 +670,35 @@ writei(struct inode *ip, char *src, uint off, uint n)
   return n;
 }
 
+// Copy n bytes of src at soff to dst at doff, straight from the
+// page cache of src.  Both must be regular files.  The caller
+// must hold both locks and be inside a transaction that has
+// room for the blocks of dst that are written.
+// Returns the number of bytes copied, short at the end of src,
+// or -1.
+int
+copyi(struct inode *dst, uint doff, struct inode *src, uint soff, uint n)
+{
+  uint tot, m;
+  char *pg;
+
+  if(src->type != T_FILE || dst->type != T_FILE)
+    return -1;
+  if(soff > src->size || soff + n < soff)
+    return -1;
+  if(soff + n > src->size)
+    n = src->size - soff;
+
+  for(tot=0; tot<n; tot+=m, soff+=m, doff+=m){
+    if((pg = pcget(src, soff/PGSIZE)) == 0)
+      break;
+    m = min(n - tot, PGSIZE - soff%PGSIZE);
+    if(writei(dst, pg + soff%PGSIZE, doff, m) != m)
+      break;
+  }
+  return tot == 0 && n > 0 ? -1 : tot;
+}
+
 //PAGEBREAK!
 // Directories
 
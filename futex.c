@@ -0,0 +1,81 @@
+// Futexes: user-space locks that enter the kernel only to sleep
+// when contended and to wake sleepers.
+//
+// A futex is named by the physical address of its user word, so
+// every process mapping that page (threads, shared memory) finds
+// the same one.  The word's kernel virtual address serves as the
+// sleep channel.  futex.lock makes checking the word and going
+// to sleep atomic with respect to futex_wake().
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "memlayout.h"
+#include "mmu.h"
+#include "proc.h"
+#include "spinlock.h"
+
+static struct {
+  struct spinlock lock;
+} futex;
+
+void
+futexinit(void)
+{
+  initlock(&futex.lock, "futex");
+}
+
+// Kernel address of the user word at uaddr, or 0.
+static uint*
+futexaddr(uint uaddr)
+{
+  char *ka;
+
+  if(uaddr % sizeof(uint) != 0 || checkptr(uaddr, sizeof(uint)) < 0)
+    return 0;
+  if((ka = uva2ka(myproc()->pgdir, (char*)uaddr)) == 0)
+    return 0;
+  return (uint*)(ka + uaddr % PGSIZE);
+}
+
+// Sleep until futex_wake() on uaddr, if the word there still
+// holds val.  Gives up after timeout ticks unless timeout is 0.
+// Returns 0 if woken or the word had changed, -1 on a bad
+// address, a timeout, or if the process has been killed.
+int
+futex_wait(uint uaddr, uint val, int timeout)
+{
+  uint *ka;
+  int r;
+
+  if((ka = futexaddr(uaddr)) == 0 || timeout < 0)
+    return -1;
+  acquire(&futex.lock);
+  if(*ka != val){
+    release(&futex.lock);
+    return 0;
+  }
+  if(myproc()->killed){
+    release(&futex.lock);
+    return -1;
+  }
+  r = sleeptimed(ka, &futex.lock, timeout);
+  release(&futex.lock);
+  return r;
+}
+
+// Wake up to n processes waiting on uaddr.
+// Returns how many were woken, or -1 on a bad address.
+int
+futex_wake(uint uaddr, int n)
+{
+  uint *ka;
+  int r;
+
+  if((ka = futexaddr(uaddr)) == 0)
+    return -1;
+  acquire(&futex.lock);
+  r = wakeupn(ka, n);
+  release(&futex.lock);
+  return r;
+}
@@ -12,6 +12,7 @@
 #include "sleeplock.h"
 #include "fs.h"
 #include "buf.h"
+#include "iostat.h"
 
 #define SECTOR_SIZE   512
 #define IDE_BSY       0x80
@@ -34,6 +35,24 @@ static struct buf *idequeue;
 static int havedisk1;
 static void idestart(struct buf*);
 
+// Request counts and latency histograms for getiostat().
+// Protected by idelock.
+static struct {
+  uint reads;
+  uint writes;
+  uint qwait[NIOHIST];
+  uint svc[NIOHIST];
+  uint total[NIOHIST];
+} idestat;
+
+// Histogram bucket for a latency of c cycles.
+static uint
+hbucket(uint64 c)
+{
+  uint i = msb64(c);
+  return i < NIOHIST ? i : NIOHIST-1;
+}
+
 // Wait for IDE disk to become ready.
 static int
 idewait(int checkerr)
@@ -84,6 +103,7 @@ idestart(struct buf *b)
 
   if (sector_per_block > 7) panic("idestart");
 
+  b->tissue = rdtsc();
   idewait(0);
   outb(0x3f6, 0);  // generate interrupt
   outb(0x1f2, sector_per_block);  // number of sectors
@@ -104,6 +124,7 @@ void
 ideintr(void)
 {
   struct buf *b;
+  uint64 now;
 
   // First queued buffer is the active request.
   acquire(&idelock);
@@ -118,6 +139,16 @@ ideintr(void)
   if(!(b->flags & B_DIRTY) && idewait(1) >= 0)
     insl(0x1f0, b->data, BSIZE/4);
 
+  // Account the request's latency.
+  now = rdtsc();
+  if(b->flags & B_DIRTY)
+    idestat.writes++;
+  else
+    idestat.reads++;
+  idestat.qwait[hbucket(b->tissue - b->tqueue)]++;
+  idestat.svc[hbucket(now - b->tissue)]++;
+  idestat.total[hbucket(now - b->tqueue)]++;
+
   // Wake process waiting for this buf.
   b->flags |= B_VALID;
   b->flags &= ~B_DIRTY;
@@ -149,6 +180,7 @@ iderw(struct buf *b)
   acquire(&idelock);  //DOC:acquire-lock
 
   // Append b to idequeue.
+  b->tqueue = rdtsc();
   b->qnext = 0;
   for(pp=&idequeue; *pp; pp=&(*pp)->qnext)  //DOC:insert-queue
     ;
@@ -166,3 +198,18 @@ iderw(struct buf *b)
 
   release(&idelock);
 }
+
+// Fill in the disk statistics of st; clear them if reset.
+void
+idestats(struct iostat *st, int reset)
+{
+  acquire(&idelock);
+  st->reads = idestat.reads;
+  st->writes = idestat.writes;
+  memmove(st->qwait, idestat.qwait, sizeof(st->qwait));
+  memmove(st->svc, idestat.svc, sizeof(st->svc));
+  memmove(st->total, idestat.total, sizeof(st->total));
+  if(reset)
+    memset(&idestat, 0, sizeof(idestat));
+  release(&idelock);
+}
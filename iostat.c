@@ -0,0 +1,70 @@
+#include "types.h"
+#include "user.h"
+#include "iostat.h"
+
+// usage: iostat          dump buffer cache and disk statistics
+//        iostat -r       clear them
+//        iostat cmd ...  clear, run cmd, then dump
+
+void hist(char *title, uint *h) {
+	int max = 0;
+	for (int i = 0; i < NIOHIST; i++)
+		if (h[i] > max)
+			max = h[i];
+	printf(1, "\n%s (cycles)\n", title);
+	if (max == 0) {
+		printf(1, "\t(none)\n");
+		return;
+	}
+	for (int i = 0; i < NIOHIST; i++) {
+		if (h[i] == 0)
+			continue;
+		printf(1, "  2^%d\t%d\t", i, h[i]);
+		for (int j = 0; j < (h[i] * 40 + max - 1) / max; j++)
+			printf(1, "*");
+		printf(1, "\n");
+	}
+}
+
+void dump(void) {
+	struct iostat st;
+
+	getiostat(&st, 0);
+	printf(1, "buffer cache: %d hits, %d misses, %d evictions", st.hits, st.misses, st.evictions);
+	if (st.hits + st.misses)
+		printf(1, " (%d%% hit)", st.hits * 100 / (st.hits + st.misses));
+	printf(1, "\npage cache: %d hits, %d misses, %d pages, %d reclaimed",
+		   st.phits, st.pmisses, st.ppages, st.preclaimed);
+	if (st.phits + st.pmisses)
+		printf(1, " (%d%% hit)", st.phits * 100 / (st.phits + st.pmisses));
+	printf(1, "\ndisk: %d reads, %d writes\n", st.reads, st.writes);
+	hist("queue wait", st.qwait);
+	hist("device service", st.svc);
+	hist("total latency", st.total);
+}
+
+int main(int argc, char **argv) {
+	struct iostat st;
+
+	if (argc == 1) {
+		dump();
+		exit();
+	}
+	getiostat(&st, 1);
+	if (strcmp(argv[1], "-r") == 0)
+		exit();
+
+	int pid = fork();
+	if (pid < 0) {
+		printf(2, "iostat: fork failed\n");
+		exit();
+	}
+	if (pid == 0) {
+		exec(argv[1], argv + 1);
+		printf(2, "iostat: exec %s failed\n", argv[1]);
+		exit();
+	}
+	wait();
+	dump();
+	exit();
+}
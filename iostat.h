@@ -0,0 +1,17 @@
+#define NIOHIST 32  // log2 latency buckets: bucket i counts [2^i, 2^(i+1)) cycles
+
+// Buffer cache and disk statistics, as returned by getiostat.
+struct iostat {
+	uint hits;         // bget() found the block cached
+	uint misses;       // bget() had to recycle a buffer
+	uint evictions;    // misses that threw away a valid block
+	uint phits;        // readi() found the file page cached
+	uint pmisses;      // readi() had to read the page in
+	uint preclaimed;   // cached pages given back to kalloc()
+	uint ppages;       // pages in the page cache now
+	uint reads;        // disk requests that read
+	uint writes;       // disk requests that wrote
+	uint qwait[NIOHIST];  // iderw() to idestart(): time in idequeue
+	uint svc[NIOHIST];    // idestart() to ideintr(): time on the device
+	uint total[NIOHIST];  // iderw() to ideintr()
+};
@@ -0,0 +1,62 @@
+#include "types.h"
+#include "user.h"
+#include "lockstat.h"
+
+// usage: lockstat          dump the lock statistics
+//        lockstat -r       clear them
+//        lockstat cmd ...  clear, run cmd, then dump
+
+void dump(void) {
+	struct lockinfo li[NLOCKSTAT], t;
+	int n = get_lockstat(li, NLOCKSTAT, 0);
+
+	// Most time spent waiting first: that is the lock to attack.
+	for (int i = 0; i < n; i++)
+		for (int j = i + 1; j < n; j++)
+			if (li[j].wait_kcycles > li[i].wait_kcycles) {
+				t = li[i];
+				li[i] = li[j];
+				li[j] = t;
+			}
+
+	printf(1, "Name\t\tType\tacq\tcont\twait(kc)\thold(kc)\tmaxhold(c)\n");
+	for (int i = 0; i < n; i++) {
+		if (li[i].acquires == 0)
+			continue;
+		printf(1, "%s\t%s%s\t%d\t%d\t%d\t\t%d\t\t%d\n",
+			   li[i].name,
+			   strlen(li[i].name) < 8 ? "\t" : "",
+			   li[i].sleep ? "sleep" : "spin",
+			   li[i].acquires,
+			   li[i].contended,
+			   li[i].wait_kcycles,
+			   li[i].hold_kcycles,
+			   li[i].max_hold);
+	}
+}
+
+int main(int argc, char **argv) {
+	if (argc == 1) {
+		dump();
+		exit();
+	}
+	if (strcmp(argv[1], "-r") == 0) {
+		get_lockstat(0, 0, 1);
+		exit();
+	}
+
+	get_lockstat(0, 0, 1);
+	int pid = fork();
+	if (pid < 0) {
+		printf(2, "lockstat: fork failed\n");
+		exit();
+	}
+	if (pid == 0) {
+		exec(argv[1], argv + 1);
+		printf(2, "lockstat: exec %s failed\n", argv[1]);
+		exit();
+	}
+	wait();
+	dump();
+	exit();
+}
@@ -0,0 +1,14 @@
+#define NLOCKSTAT 32  // maximum number of distinct lock names tracked
+
+// Contention statistics for all locks sharing one name,
+// as returned by the get_lockstat syscall.
+// Cycle counts are rdtsc cycles; totals are divided by 1024.
+struct lockinfo {
+	char name[16];
+	uint sleep;          // 1 for sleep locks, 0 for spin locks
+	uint acquires;       // number of acquisitions
+	uint contended;      // acquisitions that found the lock held
+	uint wait_kcycles;   // total cycles spent spinning/sleeping for it
+	uint hold_kcycles;   // total cycles it was held
+	uint max_hold;       // longest single hold, in cycles
+};
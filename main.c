@@ -28,6 +28,13 @@ main(void)
   uartinit();      // serial port
   pinit();         // process table
   tvinit();        // trap vectors
+  profinit();      // sampling profiler
+  traceinit();     // scheduler event trace
+  futexinit();     // futexes
+  shminit();       // shared memory
+  mmapinit();      // file mappings
+  uringinit();     // submission rings
+  pollinit();      // poll
   binit();         // buffer cache
   fileinit();      // file table
   ideinit();       // disk 
@@ -58,3 +58,9 @@ iderw(struct buf *b)
     memmove(b->data, p, BSIZE);
   b->flags |= B_VALID;
 }
+
+// The memory disk has no queue or latency to speak of.
+void
+idestats(struct iostat *st, int reset)
+{
+}
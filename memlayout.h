@@ -7,6 +7,8 @@
 // Key addresses for address space layout (see kmap in vm.c for layout)
 #define KERNBASE 0x80000000         // First kernel virtual address
 #define KERNLINK (KERNBASE+EXTMEM)  // Address where kernel is linked
+#define SHMBASE (KERNBASE-NSHMAT*SHMPAGES*PGSIZE) // Shared memory slots, see shm.c
+#define MMAPBASE (SHMBASE-0x10000000)   // File mappings, see mmap.c
 
 #define V2P(a) (((uint) (a)) - KERNBASE)
 #define P2V(a) ((void *)(((char *) (a)) + KERNBASE))
@@ -141,6 +141,10 @@ main(int argc, char *argv[])
     // in place of system binaries like rm and cat.
     if(argv[i][0] == '_')
       ++argv[i];
+    if(strlen(argv[i]) > DIRSIZ){
+      fprintf(stderr, "mkfs: %s: name longer than %d\n", argv[i], DIRSIZ);
+      exit(1);
+    }
 
     inum = ialloc(T_FILE);
 
@@ -0,0 +1,8 @@
+// mmap() protections and flags.
+#define PROT_READ   0x1  // pages can be read
+#define PROT_WRITE  0x2  // pages can be written
+
+#define MAP_SHARED  0x1  // writes go back to the file
+#define MAP_PRIVATE 0x2  // writes are private copy-on-write copies
+
+#define MAP_FAILED  ((void*)-1)
@@ -0,0 +1,451 @@
+// File mappings.
+//
+// mmap() reserves a range of addresses between MMAPBASE and
+// SHMBASE and records it in a vma; the pages are read from the
+// file when first touched, by mmapfault() from the page fault
+// handler.  Like shared memory segments, vmas belong to a page
+// table, so the threads on it share them, and fork() copies
+// them.
+//
+// A MAP_SHARED mapping maps the file's pages in the page cache
+// (fs.c), so all of them, read() and write() see the same data.
+// Dirty pages are written back to the file, through the log,
+// when they are unmapped: by munmap(), or by freevm() on exit
+// and exec.  The pages of a MAP_PRIVATE mapping
+// are the mapping's own.  fork() gives the child the same
+// physical pages, read-only in both, and the first write to one
+// copies it.  kalloc's reference counts tell who still uses a
+// page.
+//
+// System calls may touch user memory holding spinlocks, where a
+// fault could not sleep, so argptr() and friends fault the range
+// in with mmapprefault() before handing it over.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "memlayout.h"
+#include "mmu.h"
+#include "proc.h"
+#include "spinlock.h"
+#include "sleeplock.h"
+#include "stat.h"
+#include "fs.h"
+#include "file.h"
+#include "mman.h"
+
+struct vma {
+  pde_t *pgdir;     // 0 if the entry is free
+  uint start;       // page-aligned
+  uint end;
+  int prot;
+  int flags;
+  struct file *f;
+  uint off;         // file offset of start
+};
+
+// The lock is held while servicing a fault, which reads the
+// file, so it must be a sleeplock.  It comes before the log and
+// inode locks.
+static struct {
+  struct sleeplock lock;
+  struct vma vma[NVMA];
+} mm;
+
+void
+mmapinit(void)
+{
+  initsleeplock(&mm.lock, "mmap");
+}
+
+// Find the vma of pgdir containing va.  Caller holds mm.lock.
+static struct vma*
+vmafind(pde_t *pgdir, uint va)
+{
+  struct vma *v;
+
+  for(v = mm.vma; v < &mm.vma[NVMA]; v++)
+    if(v->pgdir == pgdir && va >= v->start && va < v->end)
+      return v;
+  return 0;
+}
+
+// Find a free vma.  Caller holds mm.lock.
+static struct vma*
+vmaalloc(void)
+{
+  struct vma *v;
+
+  for(v = mm.vma; v < &mm.vma[NVMA]; v++)
+    if(v->pgdir == 0)
+      return v;
+  return 0;
+}
+
+// Lowest address at which len bytes fit between the vmas of
+// pgdir, or 0.  Caller holds mm.lock.
+static uint
+vmaspace(pde_t *pgdir, uint len)
+{
+  struct vma *v;
+  uint va;
+
+  for(va = MMAPBASE; va + len > va && va + len <= SHMBASE; ){
+    for(v = mm.vma; v < &mm.vma[NVMA]; v++)
+      if(v->pgdir == pgdir && va < v->end && va + len > v->start)
+        break;
+    if(v == &mm.vma[NVMA])
+      return va;
+    va = v->end;
+  }
+  return 0;
+}
+
+// Write the page mem back to ip at off, in transactions small
+// enough for the log.  The file does not grow: whatever of the
+// page lies past its end is dropped.
+static void
+writepage(struct inode *ip, char *mem, uint off)
+{
+  int max = ((MAXOPBLOCKS-1-1-2) / 2) * BSIZE;
+  uint i, n;
+
+  for(i = 0; i < PGSIZE; i += n){
+    n = PGSIZE - i;
+    if(n > max)
+      n = max;
+    begin_op();
+    ilock(ip);
+    if(off + i >= ip->size){
+      iunlock(ip);
+      end_op();
+      break;
+    }
+    if(off + i + n > ip->size)
+      n = ip->size - off - i;
+    writei(ip, mem + i, off + i, n);
+    iunlock(ip);
+    end_op();
+  }
+}
+
+// Drop the pages of v in [start, end) from pgdir, writing the
+// dirty ones back first if v is shared.  The caller has cleared
+// PTE_P and shot down the TLBs if other CPUs may use pgdir.
+// Caller holds mm.lock.
+static void
+vmaunmap(pde_t *pgdir, struct vma *v, uint start, uint end)
+{
+  pte_t *pte;
+  uint va;
+
+  for(va = start; va < end; va += PGSIZE){
+    if((pte = walkpgdir(pgdir, (char*)va, 0)) == 0 || PTE_ADDR(*pte) == 0)
+      continue;
+    if((v->flags & MAP_SHARED) && (*pte & PTE_D))
+      writepage(v->f->ip, P2V(PTE_ADDR(*pte)), v->off + va - v->start);
+    kfree(P2V(PTE_ADDR(*pte)));
+    *pte = 0;
+  }
+}
+
+// Map len bytes of f, from page-aligned offset off, into the
+// current process.  Returns the address, or -1.
+int
+mmap(uint len, int prot, int flags, struct file *f, uint off)
+{
+  pde_t *pgdir = myproc()->pgdir;
+  struct vma *v;
+  uint va;
+
+  if(len == 0 || off % PGSIZE != 0 || (prot & ~(PROT_READ|PROT_WRITE)))
+    return -1;
+  if(flags != MAP_SHARED && flags != MAP_PRIVATE)
+    return -1;
+  if(f->type != FD_INODE || !f->readable)
+    return -1;
+  if(flags == MAP_SHARED && (prot & PROT_WRITE) && !f->writable)
+    return -1;
+  ilock(f->ip);
+  if(f->ip->type != T_FILE){
+    iunlock(f->ip);
+    return -1;
+  }
+  iunlock(f->ip);
+
+  len = PGROUNDUP(len);
+  acquiresleep(&mm.lock);
+  if(len == 0 || (va = vmaspace(pgdir, len)) == 0 || (v = vmaalloc()) == 0){
+    releasesleep(&mm.lock);
+    return -1;
+  }
+  v->pgdir = pgdir;
+  v->start = va;
+  v->end = va + len;
+  v->prot = prot;
+  v->flags = flags;
+  v->f = filedup(f);
+  v->off = off;
+  releasesleep(&mm.lock);
+  return va;
+}
+
+// Remove the mappings of the current process in [addr, addr+len).
+// Returns -1 if addr is not page-aligned, if punching a hole
+// in a mapping needs a vma and there are none left, or if a
+// system call of another thread has some of the range pinned.
+// checkptr() takes mm.lock after pinning, so holding it from
+// the check on keeps new pins out of the range.
+int
+munmap(uint addr, uint len)
+{
+  pde_t *pgdir = myproc()->pgdir;
+  struct vma *v, *hole;
+  uint start, end, va;
+  pte_t *pte;
+
+  end = PGROUNDUP(addr + len);
+  if(addr % PGSIZE != 0 || len == 0 || end <= addr)
+    return -1;
+
+  acquiresleep(&mm.lock);
+  for(v = mm.vma; v < &mm.vma[NVMA]; v++)
+    if(v->pgdir == pgdir && addr > v->start && end < v->end)
+      break;
+  hole = 0;
+  if(v < &mm.vma[NVMA] && (hole = vmaalloc()) == 0){
+    releasesleep(&mm.lock);
+    return -1;
+  }
+  if(uvmpinned(pgdir, addr, end)){
+    releasesleep(&mm.lock);
+    return -1;
+  }
+
+  // Other threads may have the pages in their TLBs; they must
+  // be gone from there before the pages are written or freed.
+  for(va = addr; va < end; va += PGSIZE)
+    if(vmafind(pgdir, va) && (pte = walkpgdir(pgdir, (char*)va, 0)) != 0)
+      *pte &= ~PTE_P;
+  tlbshootdown(pgdir);
+
+  for(v = mm.vma; v < &mm.vma[NVMA]; v++){
+    if(v->pgdir != pgdir || addr >= v->end || end <= v->start)
+      continue;
+    start = addr > v->start ? addr : v->start;
+    vmaunmap(pgdir, v, start, end < v->end ? end : v->end);
+    if(start == v->start && end >= v->end){
+      fileclose(v->f);
+      v->pgdir = 0;
+    } else if(start == v->start){
+      v->off += end - v->start;
+      v->start = end;
+    } else if(end >= v->end){
+      v->end = start;
+    } else {
+      *hole = *v;
+      hole->off += end - v->start;
+      hole->start = end;
+      hole->f = filedup(v->f);
+      v->end = start;
+    }
+  }
+  releasesleep(&mm.lock);
+  return 0;
+}
+
+// Make the page at va of vma v present, and writable if write.
+// Caller holds mm.lock.
+static int
+vmafault(pde_t *pgdir, struct vma *v, uint va, int write)
+{
+  pte_t *pte;
+  char *mem, *old;
+  uint off;
+  int perm;
+
+  va = PGROUNDDOWN(va);
+  perm = PTE_U;
+  if(v->prot & PROT_WRITE)
+    perm |= PTE_W;
+  pte = walkpgdir(pgdir, (char*)va, 0);
+
+  if(pte == 0 || (*pte & PTE_P) == 0){
+    off = v->off + va - v->start;
+    ilock(v->f->ip);
+    mem = 0;
+    if(v->flags & MAP_SHARED)
+      mem = pcref(v->f->ip, off);
+    if(mem == 0 && (mem = kalloc()) != 0){
+      memset(mem, 0, PGSIZE);
+      if(off < v->f->ip->size)
+        readi(v->f->ip, mem, off, PGSIZE);
+    }
+    iunlock(v->f->ip);
+    if(mem == 0)
+      return -1;
+    if(mappages(pgdir, (char*)va, PGSIZE, V2P(mem), perm) < 0){
+      kfree(mem);
+      return -1;
+    }
+    return 0;
+  }
+
+  if(!write || (*pte & PTE_W))
+    return 0;
+  if((v->prot & PROT_WRITE) == 0 || (v->flags & MAP_PRIVATE) == 0)
+    return -1;
+
+  // Copy-on-write: the page is shared with a fork()ed process.
+  old = P2V(PTE_ADDR(*pte));
+  if(krefs(old) == 1){
+    *pte |= PTE_W;
+    return 0;
+  }
+  if((mem = kalloc()) == 0)
+    return -1;
+  memmove(mem, old, PGSIZE);
+  *pte = V2P(mem) | perm | PTE_P;
+  tlbshootdown(pgdir);
+  kfree(old);
+  return 0;
+}
+
+// Service a page fault at va, for a write if write.  Returns 0
+// if the access can be retried, -1 if va is not mapped or not
+// for that access.
+int
+mmapfault(uint va, int write)
+{
+  pde_t *pgdir = myproc()->pgdir;
+  struct vma *v;
+  int r = -1;
+
+  if(va < MMAPBASE || va >= SHMBASE)
+    return -1;
+  acquiresleep(&mm.lock);
+  if((v = vmafind(pgdir, va)) != 0 && v->prot != 0 &&
+     (!write || (v->prot & PROT_WRITE)))
+    r = vmafault(pgdir, v, va, write);
+  releasesleep(&mm.lock);
+  return r;
+}
+
+// Fault in the mapped pages of the current process in
+// [va, va+n), writable where their mapping is, so that the
+// kernel can use them without faulting.  Returns -1 if that
+// fails; addresses outside mappings are left alone.
+int
+mmapprefault(uint va, uint n)
+{
+  pde_t *pgdir = myproc()->pgdir;
+  struct vma *v;
+  uint a;
+  int r = 0;
+
+  if(va + n <= MMAPBASE || va >= SHMBASE || n == 0)
+    return 0;
+  acquiresleep(&mm.lock);
+  for(a = PGROUNDDOWN(va); a < va + n && r == 0; a += PGSIZE)
+    if((v = vmafind(pgdir, a)) != 0 && v->prot != 0)
+      r = vmafault(pgdir, v, a, (v->prot & PROT_WRITE) != 0);
+  releasesleep(&mm.lock);
+  return r;
+}
+
+// End of the mapping of pgdir that contains va, or 0 if there
+// is none.
+uint
+mmapend(pde_t *pgdir, uint va)
+{
+  struct vma *v;
+  uint end = 0;
+
+  acquiresleep(&mm.lock);
+  if((v = vmafind(pgdir, va)) != 0)
+    end = v->end;
+  releasesleep(&mm.lock);
+  return end;
+}
+
+// Give page table to the same mappings as from (for fork).
+// Private pages become copy-on-write in both, except those a
+// system call of another thread has pinned: it may be writing
+// them, and the fault would panic the kernel if it holds a
+// spinlock, so the child gets a copy of those now.  On
+// failure, freevm(to) cleans up what was done.
+int
+mmapfork(pde_t *from, pde_t *to)
+{
+  struct vma *v, *nv;
+  pte_t *pte;
+  uint va, flags;
+  char *mem;
+  int cow = 0, r = 0;
+
+  acquiresleep(&mm.lock);
+  for(v = mm.vma; v < &mm.vma[NVMA] && r == 0; v++){
+    if(v->pgdir != from)
+      continue;
+    if((nv = vmaalloc()) == 0){
+      r = -1;
+      break;
+    }
+    *nv = *v;
+    nv->pgdir = to;
+    nv->f = filedup(v->f);
+    for(va = v->start; va < v->end; va += PGSIZE){
+      if((pte = walkpgdir(from, (char*)va, 0)) == 0 || (*pte & PTE_P) == 0)
+        continue;
+      flags = PTE_FLAGS(*pte) & ~(PTE_P|PTE_A|PTE_D);
+      if((v->flags & MAP_PRIVATE) && (*pte & PTE_W) &&
+         uvmpinned(from, va, va + PGSIZE)){
+        if((mem = kalloc()) == 0){
+          r = -1;
+          break;
+        }
+        memmove(mem, P2V(PTE_ADDR(*pte)), PGSIZE);
+        if(mappages(to, (char*)va, PGSIZE, V2P(mem), flags) < 0){
+          kfree(mem);
+          r = -1;
+          break;
+        }
+        continue;
+      }
+      if((v->flags & MAP_PRIVATE) && (*pte & PTE_W)){
+        *pte &= ~PTE_W;
+        flags &= ~PTE_W;
+        cow = 1;
+      }
+      if(mappages(to, (char*)va, PGSIZE, PTE_ADDR(*pte), flags) < 0){
+        r = -1;
+        break;
+      }
+      kref(P2V(PTE_ADDR(*pte)));
+    }
+  }
+  // Other threads of from may still write through stale entries.
+  if(cow)
+    tlbshootdown(from);
+  releasesleep(&mm.lock);
+  return r;
+}
+
+// Drop every mapping of pgdir, which is being freed, writing
+// back dirty shared pages.  The caller must not be inside a
+// file system transaction.
+void
+mmapfree(pde_t *pgdir)
+{
+  struct vma *v;
+
+  acquiresleep(&mm.lock);
+  for(v = mm.vma; v < &mm.vma[NVMA]; v++){
+    if(v->pgdir != pgdir)
+      continue;
+    vmaunmap(pgdir, v, v->start, v->end);
+    fileclose(v->f);
+    v->pgdir = 0;
+  }
+  releasesleep(&mm.lock);
+}
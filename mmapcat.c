@@ -0,0 +1,144 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "fcntl.h"
+#include "mman.h"
+
+// usage: mmapcat [-s] file [kbytes]
+//
+// Sums the bytes of file twice, with read() through a 512-byte
+// buffer and through a MAP_PRIVATE mapping, and prints how many
+// ticks each took.  If kbytes is given, the file is first
+// created with that much data.  With -s it then checks that
+// writes through a private mapping stay private (also after
+// fork) and that writes through a shared one reach the file.
+
+char buf[512];
+
+int viaread(char *file, uint *sum) {
+	int fd, n, i;
+
+	if ((fd = open(file, O_RDONLY)) < 0)
+		return -1;
+	*sum = 0;
+	while ((n = read(fd, buf, sizeof(buf))) > 0)
+		for (i = 0; i < n; i++)
+			*sum += (uchar)buf[i];
+	close(fd);
+	return 0;
+}
+
+int viammap(char *file, uint size, uint *sum) {
+	uchar *p;
+	int fd;
+	uint i;
+
+	if ((fd = open(file, O_RDONLY)) < 0)
+		return -1;
+	p = mmap(0, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (p == MAP_FAILED)
+		return -1;
+	*sum = 0;
+	for (i = 0; i < size; i++)
+		*sum += p[i];
+	return munmap(p, size);
+}
+
+// The first byte of file, or -1.
+int first(char *file) {
+	int fd;
+	char c;
+
+	if ((fd = open(file, O_RDONLY)) < 0 || read(fd, &c, 1) != 1)
+		return -1;
+	close(fd);
+	return (uchar)c;
+}
+
+int semantics(char *file, uint size) {
+	char *p, seen;
+	int fd, pfd[2], c, bad = 0;
+
+	c = first(file);
+	if ((fd = open(file, O_RDWR)) < 0 || pipe(pfd) < 0)
+		return -1;
+
+	// Private: the file and a fork()ed child keep the old byte.
+	if ((p = mmap(0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0)) == MAP_FAILED)
+		return -1;
+	bad += (uchar)p[0] != c;  // fault it in before fork: copy-on-write
+	if (fork() == 0) {
+		read(pfd[0], &seen, 1);
+		write(pfd[1], p, 1);
+		exit();
+	}
+	p[0] = c + 1;
+	write(pfd[1], p, 1);
+	wait();
+	read(pfd[0], &seen, 1);
+	bad += (uchar)seen != c;
+	bad += munmap(p, size) < 0;
+	bad += first(file) != c;
+	close(pfd[0]);
+	close(pfd[1]);
+
+	// Shared: the write is in the file after munmap().
+	if ((p = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED)
+		return -1;
+	p[0] = c + 1;
+	bad += munmap(p, size) < 0;
+	bad += first(file) != (uchar)(c + 1);
+	close(fd);
+	return bad;
+}
+
+int main(int argc, char **argv) {
+	struct stat st;
+	uint s1, s2;
+	int t, t1, t2, check = 0, fd, i;
+
+	if (argc > 1 && strcmp(argv[1], "-s") == 0) {
+		check = 1;
+		argv++, argc--;
+	}
+	if (argc < 2) {
+		printf(2, "usage: mmapcat [-s] file [kbytes]\n");
+		exit();
+	}
+	if (argc > 2) {
+		unlink(argv[1]);
+		if ((fd = open(argv[1], O_CREATE | O_RDWR)) < 0) {
+			printf(2, "mmapcat: cannot create %s\n", argv[1]);
+			exit();
+		}
+		for (i = 0; i < sizeof(buf); i++)
+			buf[i] = i * 7;
+		for (i = atoi(argv[2]) * 2; i > 0; i--)
+			write(fd, buf, sizeof(buf));
+		close(fd);
+	}
+	if (stat(argv[1], &st) < 0) {
+		printf(2, "mmapcat: cannot stat %s\n", argv[1]);
+		exit();
+	}
+
+	t = uptime();
+	if (viaread(argv[1], &s1) < 0) {
+		printf(2, "mmapcat: read failed\n");
+		exit();
+	}
+	t1 = uptime() - t;
+	t = uptime();
+	if (viammap(argv[1], st.size, &s2) < 0) {
+		printf(2, "mmapcat: mmap failed\n");
+		exit();
+	}
+	t2 = uptime() - t;
+	printf(1, "%d bytes: read %d ticks, mmap %d ticks, sums %s\n", st.size,
+		   t1, t2, s1 == s2 ? "match" : "DIFFER");
+
+	if (check)
+		printf(1, "semantics: %s\n", semantics(argv[1], st.size) == 0 ? "ok" : "FAILED");
+	exit();
+}
@@ -0,0 +1,107 @@
+#include "types.h"
+#include "param.h"
+#include "user.h"
+#include "fcntl.h"
+#include "poll.h"
+
+// usage: mux [n]
+//
+// Starts n (default 4) children that each send MSGS messages
+// down a pipe of their own, child i sleeping i ticks between
+// them.  The parent serves all the pipes, as one process, with
+// poll() until every child has hung up, and prints how many
+// messages came from each and how many poll() calls that took.
+// Then checks O_NONBLOCK: reading an empty pipe and writing a
+// full one fail instead of waiting, and poll() times out.
+
+#define MSGS 20
+
+struct pollfd fds[NOFILE];
+int got[NOFILE];
+
+void child(int fd, int pace) {
+	for (int i = 0; i < MSGS; i++) {
+		write(fd, &i, sizeof(i));
+		sleep(pace);
+	}
+	exit();
+}
+
+int serve(int n) {
+	char buf[64];
+	int open = n, polls = 0, i, r;
+
+	while (open > 0) {
+		if (poll(fds, n, -1) <= 0)
+			return -1;
+		polls++;
+		for (i = 0; i < n; i++) {
+			if (fds[i].revents & POLLIN) {
+				if ((r = read(fds[i].fd, buf, sizeof(buf))) > 0) {
+					got[i] += r;
+					continue;
+				}
+			}
+			if (fds[i].revents) {  // hung up, and drained
+				close(fds[i].fd);
+				fds[i].fd = -1;
+				open--;
+			}
+		}
+	}
+	return polls;
+}
+
+int nonblock(void) {
+	char buf[64];
+	int p[2], bad = 0, n;
+
+	if (pipe(p) < 0)
+		return -1;
+	fcntl(p[0], F_SETFL, O_NONBLOCK);
+	fcntl(p[1], F_SETFL, O_NONBLOCK);
+	bad += (fcntl(p[0], F_GETFL, 0) & O_NONBLOCK) == 0;
+	bad += read(p[0], buf, sizeof(buf)) != -1;
+	for (n = 0; write(p[1], buf, sizeof(buf)) > 0; n++)
+		;
+	bad += n == 0;
+	fds[0].fd = p[1];
+	fds[0].events = POLLOUT;
+	bad += poll(fds, 1, 5) != 0;
+	bad += read(p[0], buf, sizeof(buf)) != sizeof(buf);
+	bad += poll(fds, 1, 5) != 1 || fds[0].revents != POLLOUT;
+	close(p[0]);
+	close(p[1]);
+	return bad;
+}
+
+int main(int argc, char **argv) {
+	int n = argc > 1 ? atoi(argv[1]) : 4, p[2], i, polls;
+
+	if (n < 1 || n > NOFILE - 3) {
+		printf(2, "mux: n must be 1 to %d\n", NOFILE - 3);
+		exit();
+	}
+	for (i = 0; i < n; i++) {
+		if (pipe(p) < 0) {
+			printf(2, "mux: pipe failed\n");
+			exit();
+		}
+		if (fork() == 0) {
+			close(p[0]);
+			child(p[1], i);
+		}
+		close(p[1]);
+		fds[i].fd = p[0];
+		fds[i].events = POLLIN;
+	}
+
+	polls = serve(n);
+	for (i = 0; i < n; i++)
+		wait();
+	for (i = 0; i < n; i++)
+		printf(1, "pipe %d: %d of %d messages\n", i, got[i] / sizeof(int), MSGS);
+	printf(1, "%d polls\n", polls);
+	printf(1, "nonblocking: %s\n", nonblock() == 0 ? "ok" : "FAILED");
+	exit();
+}
@@ -2,19 +2,33 @@
 #define KSTACKSIZE 4096  // size of per-process kernel stack
 #define NCPU          8  // maximum number of CPUs
 #define NOFILE       16  // open files per process
+#define NFDHOLD       2  // descriptors a system call can use at once
 #define NFILE       100  // open files per system
 #define NINODE       50  // maximum number of active i-nodes
 #define NDEV         10  // maximum major device number
 #define ROOTDEV       1  // device number of file system root disk
 #define MAXARG       32  // max exec arguments
+#define MAXPATH     128  // maximum file path name
 #define MAXOPBLOCKS  10  // max # of blocks any FS op writes
 #define LOGSIZE      (MAXOPBLOCKS*3)  // max data blocks in on-disk log
 #define NBUF         (MAXOPBLOCKS*3)  // size of disk block cache
-#define FSSIZE       1000  // size of file system in blocks
+#define FSSIZE       3000  // size of file system in blocks
+#define NSHM         16  // shared memory segments per system
+#define SHMPAGES     16  // maximum pages in a shared memory segment
+#define NSHMAT        4  // shared memory segments a process can attach
+#define NVMA         64  // file mappings per system
+#define NRUHIST      32  // log2 latency buckets: bucket i counts [2^i, 2^(i+1)) cycles
+#define NURING        8  // submission rings per system
+#define NURINGWORKER  2  // kernel threads per ring
+#define NPOLLER       8  // processes that can poll() one pipe or device
+#define NVMLOCK      16  // locks shared out among page tables
+#define NPIN          4  // user memory ranges a system call keeps apart
 #define RR_SCHED     0
 #define FCFS_SCHED   1
 #define PBS_SCHED    2
 #define MLFQ_SCHED   3
+#define CFS_SCHED    4
+#define STRIDE_SCHED 5
 #ifndef SCHEDULER
 #define SCHEDULER    RR_SCHED
 #endif
@@ -0,0 +1,48 @@
+#include "types.h"
+#include "user.h"
+
+// usage: parsum [nthreads]
+//
+// Adds up a long series split over nthreads threads (default 4)
+// and prints how many ticks it took, to check that threads
+// spread over the CPUS.
+
+#define N 400000000
+#define MAXTHREADS 16
+
+int nthreads = 4;
+uint partial[MAXTHREADS];
+
+void work(void *arg) {
+	int t = (int)arg;
+	uint s = 0;
+
+	for (int i = t; i < N; i += nthreads)
+		s += i;
+	partial[t] = s;
+}
+
+int main(int argc, char **argv) {
+	uint sum = 0;
+	int start, t;
+
+	if (argc > 1)
+		nthreads = atoi(argv[1]);
+	if (nthreads < 1 || nthreads > MAXTHREADS) {
+		printf(2, "parsum: 1 to %d threads\n", MAXTHREADS);
+		exit();
+	}
+
+	start = uptime();
+	for (t = 0; t < nthreads; t++)
+		if (thread_create(work, (void *)t) < 0) {
+			printf(2, "parsum: thread_create failed\n");
+			exit();
+		}
+	for (t = 0; t < nthreads; t++)
+		thread_join();
+	for (t = 0; t < nthreads; t++)
+		sum += partial[t];
+	printf(1, "%d threads: sum %x in %d ticks\n", nthreads, sum, uptime() - start);
+	exit();
+}
@@ -10,4 +10,5 @@ struct pinfo {
 	uint n_run;
 	uint cur_q;
 	uint ticks[QCNT];
+	uint dl_misses;
 };
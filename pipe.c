@@ -7,6 +7,8 @@
 #include "spinlock.h"
 #include "sleeplock.h"
 #include "file.h"
+#include "uio.h"
+#include "poll.h"
 
 #define PIPESIZE 512
 
@@ -17,6 +19,7 @@ struct pipe {
   uint nwrite;    // number of bytes written
   int readopen;   // read fd is still open
   int writeopen;  // write fd is still open
+  struct waitq wq;  // pollers
 };
 
 int
@@ -34,6 +37,7 @@ pipealloc(struct file **f0, struct file **f1)
   p->writeopen = 1;
   p->nwrite = 0;
   p->nread = 0;
+  memset(&p->wq, 0, sizeof(p->wq));
   initlock(&p->lock, "pipe");
   (*f0)->type = FD_PIPE;
   (*f0)->readable = 1;
@@ -67,6 +71,7 @@ pipeclose(struct pipe *p, int writable)
     p->readopen = 0;
     wakeup(&p->nwrite);
   }
+  pollwake(&p->wq);
   if(p->readopen == 0 && p->writeopen == 0){
     release(&p->lock);
     kfree((char*)p);
@@ -75,47 +80,91 @@ pipeclose(struct pipe *p, int writable)
 }
 
 //PAGEBREAK: 40
+// Write the n buffers of iov to the pipe.  If nonblock, write
+// only what fits, and fail if nothing does.
 int
-pipewrite(struct pipe *p, char *addr, int n)
+pipewrite(struct pipe *p, struct iovec *iov, int n, int nonblock)
 {
-  int i;
+  int i, j, tot = 0;
+  char *addr;
 
   acquire(&p->lock);
-  for(i = 0; i < n; i++){
-    while(p->nwrite == p->nread + PIPESIZE){  //DOC: pipewrite-full
-      if(p->readopen == 0 || myproc()->killed){
-        release(&p->lock);
-        return -1;
+  for(j = 0; j < n; j++){
+    addr = iov[j].iov_base;
+    for(i = 0; i < iov[j].iov_len; i++){
+      while(p->nwrite == p->nread + PIPESIZE){  //DOC: pipewrite-full
+        if(p->readopen == 0 || myproc()->killed){
+          release(&p->lock);
+          return -1;
+        }
+        if(nonblock){
+          if(tot == 0)
+            tot = -1;
+          goto out;
+        }
+        wakeup(&p->nread);
+        pollwake(&p->wq);
+        sleep(&p->nwrite, &p->lock);  //DOC: pipewrite-sleep
       }
-      wakeup(&p->nread);
-      sleep(&p->nwrite, &p->lock);  //DOC: pipewrite-sleep
+      p->data[p->nwrite++ % PIPESIZE] = addr[i];
+      tot++;
     }
-    p->data[p->nwrite++ % PIPESIZE] = addr[i];
   }
+out:
   wakeup(&p->nread);  //DOC: pipewrite-wakeup1
+  pollwake(&p->wq);
   release(&p->lock);
-  return n;
+  return tot;
 }
 
+// Read into the n buffers of iov what is in the pipe, waiting
+// only until there is something, or failing then if nonblock.
 int
-piperead(struct pipe *p, char *addr, int n)
+piperead(struct pipe *p, struct iovec *iov, int n, int nonblock)
 {
-  int i;
+  int i, j, tot = 0;
+  char *addr;
 
   acquire(&p->lock);
   while(p->nread == p->nwrite && p->writeopen){  //DOC: pipe-empty
-    if(myproc()->killed){
+    if(myproc()->killed || nonblock){
       release(&p->lock);
       return -1;
     }
     sleep(&p->nread, &p->lock); //DOC: piperead-sleep
   }
-  for(i = 0; i < n; i++){  //DOC: piperead-copy
-    if(p->nread == p->nwrite)
-      break;
-    addr[i] = p->data[p->nread++ % PIPESIZE];
+  for(j = 0; j < n && p->nread != p->nwrite; j++){
+    addr = iov[j].iov_base;
+    for(i = 0; i < iov[j].iov_len; i++){  //DOC: piperead-copy
+      if(p->nread == p->nwrite)
+        break;
+      addr[i] = p->data[p->nread++ % PIPESIZE];
+    }
+    tot += i;
   }
   wakeup(&p->nwrite);  //DOC: piperead-wakeup
+  pollwake(&p->wq);
+  release(&p->lock);
+  return tot;
+}
+
+// What the pipe is ready for, as POLL* bits, for filepoll().
+// Puts pw, if not 0, on its wait queue.
+int
+pipepoll(struct pipe *p, struct poller *pw)
+{
+  int r = 0;
+
+  acquire(&p->lock);
+  if(p->nread != p->nwrite || !p->writeopen)
+    r |= POLLIN;
+  if(!p->writeopen)
+    r |= POLLHUP;
+  if(p->nwrite != p->nread + PIPESIZE || !p->readopen)
+    r |= POLLOUT;
+  if(!p->readopen)
+    r |= POLLERR;
+  pollwait(&p->wq, pw);
   release(&p->lock);
-  return i;
+  return r;
 }
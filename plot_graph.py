@@ -1,43 +1,143 @@
 #!/bin/env python3
+#
+# Plot scheduler behaviour.
+#
+#   plot_graph.py                        old "ticks pid queue" text in ./logs
+#   plot_graph.py trace                  binary trace written by schedtrace
+#   plot_graph.py --fsimg fs.img trace   same, read straight out of fs.img
+#
+# With queue information (MLFQ) the queue of each process is plotted
+# against ticks, otherwise a timeline of when each process ran on
+# which CPU.  --timeline forces the latter.
+import argparse
+import struct
 import matplotlib.pyplot as plt
-import numpy as np
 
-logs = 0
-with open('logs') as f:
-    logs = f.readlines()
+# struct schedevent in trace.h
+EVENT = struct.Struct('<QIHBBi')
+TR_DISPATCH, TR_PREEMPT, TR_SLEEP, TR_WAKEUP, TR_QUEUE, TR_EXIT = range(1, 7)
 
-data = [{} for _ in range(0, 10)]
+# xv6 file system layout, from fs.h
+BSIZE = 512
+NDIRECT = 12
+DINODE = struct.Struct('<hhhhI13I')
+DIRENT = struct.Struct('<H14s')
+ROOTINO = 1
 
-for line in logs:
-    line = line.split()
-    tick, pid, q = line
-    pid = int(pid) - 4
-    data[pid][tick] = int(q)
 
-#print(list(data[0].values()))
+def fsimg_read(img, name):
+    """Return the contents of file name in the root directory of img."""
+    def block(b):
+        return img[b * BSIZE:(b + 1) * BSIZE]
 
-#x = [[] for _ in range(10)]
-#y = [[] for _ in range(10)]
+    _, _, _, _, _, inodestart, _ = struct.unpack('<7I', block(1)[:28])
 
+    def inode(inum):
+        ipb = BSIZE // DINODE.size
+        b = block(inodestart + inum // ipb)
+        off = (inum % ipb) * DINODE.size
+        f = DINODE.unpack(b[off:off + DINODE.size])
+        return f[4], f[5:]
 
-marks = [".", ",", "o", "v", "^", "<", ">", "8", "s",
-         "p", "P", "*", "h", "H", "+", "x", "X", "D", "d"]
+    def data(inum):
+        size, addrs = inode(inum)
+        blocks = list(addrs[:NDIRECT])
+        if addrs[NDIRECT]:
+            blocks += struct.unpack('<128I', block(addrs[NDIRECT]))
+        return b''.join(block(b) for b in blocks if b)[:size]
 
-#for i in range(0, 10):
-#    for tick in sorted(data[i]):
-#        x[i].append(tick)
-#        y[i].append(data[i][tick])
-        
+    root = data(ROOTINO)
+    for off in range(0, len(root), DIRENT.size):
+        inum, n = DIRENT.unpack(root[off:off + DIRENT.size])
+        if inum and n.rstrip(b'\0').decode() == name[:14]:
+            return data(inum)
+    raise SystemExit('%s: not found in image' % name)
 
-#for i in range(0, 10):
-#    plt.plot(y[i], label=i+4, marker=marks[i])
 
-for pid in range(0,10):
-    plt.plot(list(data[pid].values()), linestyle='-', marker='o', label = str(pid+4))
+def read_trace(raw):
+    events = [EVENT.unpack_from(raw, off)
+              for off in range(0, len(raw) - EVENT.size + 1, EVENT.size)]
+    # Events come from per-CPU rings; the TSCs put them back in order.
+    events.sort(key=lambda e: e[0])
+    return events
 
-plt.yticks([0,1,2,3,4])
-plt.xlabel('ticks')
-plt.ylabel('queue')
-#plt.xticks(np.arange(0, 2100, 100))
-plt.legend()
-plt.show()
+
+def read_logs(path):
+    events = []
+    with open(path) as f:
+        for line in f:
+            tick, pid, q = line.replace('::=', '').split()
+            events.append((int(tick), int(tick), int(pid), 0, TR_QUEUE, int(q)))
+    return events
+
+
+def plot_queues(events):
+    data = {}
+    for tsc, tick, pid, cpu, typ, arg in events:
+        if typ in (TR_DISPATCH, TR_QUEUE) and arg >= 0:
+            data.setdefault(pid, {})[tick] = arg
+    for pid in sorted(data):
+        ticks = sorted(data[pid])
+        plt.plot(ticks, [data[pid][t] for t in ticks],
+                 linestyle='-', marker='o', label=str(pid))
+    plt.yticks([0, 1, 2, 3, 4])
+    plt.xlabel('ticks')
+    plt.ylabel('queue')
+
+
+def plot_timeline(events):
+    t0 = events[0][0]
+    running = {}    # cpu -> (pid, start)
+    pids = sorted({e[2] for e in events})
+    row = {pid: i for i, pid in enumerate(pids)}
+    colors = plt.rcParams['axes.prop_cycle'].by_key()['color']
+
+    def stop(cpu, tsc):
+        if cpu in running:
+            pid, start = running.pop(cpu)
+            plt.barh(row[pid], (tsc - start) / 1e6, left=(start - t0) / 1e6,
+                     color=colors[cpu % len(colors)])
+
+    for tsc, tick, pid, cpu, typ, arg in events:
+        if typ == TR_DISPATCH:
+            stop(cpu, tsc)
+            running[cpu] = (pid, tsc)
+        elif typ in (TR_PREEMPT, TR_SLEEP, TR_EXIT):
+            stop(cpu, tsc)
+    for cpu in list(running):
+        stop(cpu, events[-1][0])
+
+    plt.yticks(range(len(pids)), [str(p) for p in pids])
+    plt.xlabel('Mcycles (colour = CPU)')
+    plt.ylabel('pid')
+
+
+def main():
+    ap = argparse.ArgumentParser()
+    ap.add_argument('file', nargs='?', help='binary trace from schedtrace')
+    ap.add_argument('--fsimg', help='read file out of this xv6 disk image')
+    ap.add_argument('--timeline', action='store_true',
+                    help='plot a run timeline even if queues are known')
+    args = ap.parse_args()
+
+    if args.file is None:
+        events = read_logs('logs')
+    elif args.fsimg:
+        with open(args.fsimg, 'rb') as f:
+            events = read_trace(fsimg_read(f.read(), args.file))
+    else:
+        with open(args.file, 'rb') as f:
+            events = read_trace(f.read())
+    if not events:
+        raise SystemExit('no events')
+
+    if not args.timeline and any(e[5] >= 0 and e[4] == TR_QUEUE for e in events):
+        plot_queues(events)
+        plt.legend()
+    else:
+        plot_timeline(events)
+    plt.show()
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,151 @@
+// poll(): wait for any of several file descriptors.
+//
+// Pipes and devices that can make a reader or a writer wait keep
+// a wait queue (struct waitq in file.h) and call pollwake() when
+// anything about them changes.  poll() checks each descriptor
+// and at the same time, under the pipe's or device's own lock,
+// puts itself on its queue, so a change after the check wakes
+// it.  It then sleeps on its struct poller until it is woken,
+// and takes itself off every queue before looking again.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "mmu.h"
+#include "proc.h"
+#include "spinlock.h"
+#include "sleeplock.h"
+#include "fs.h"
+#include "file.h"
+#include "poll.h"
+
+static struct {
+  struct spinlock lock;  // protects wait queues and pollers
+} pollt;
+
+void
+pollinit(void)
+{
+  initlock(&pollt.lock, "poll");
+}
+
+// Put pw, if not 0, on wait queue q.  The caller holds the lock
+// of q's owner, the one it holds when calling pollwake(q).
+void
+pollwait(struct waitq *q, struct poller *pw)
+{
+  int i;
+
+  if(pw == 0)
+    return;
+  acquire(&pollt.lock);
+  for(i = 0; i < NPOLLER; i++)
+    if(q->w[i] == 0)
+      break;
+  if(i < NPOLLER && pw->nq < NOFILE){
+    q->w[i] = pw;
+    pw->q[pw->nq++] = q;
+  } else
+    pw->full = 1;
+  release(&pollt.lock);
+}
+
+// Wake the pollers on q.  The caller holds the lock of q's
+// owner, so no poller can be joining q: if it looks empty, it
+// is, and the global lock is not needed.
+void
+pollwake(struct waitq *q)
+{
+  int i;
+
+  for(i = 0; i < NPOLLER; i++)
+    if(q->w[i])
+      break;
+  if(i == NPOLLER)
+    return;
+
+  acquire(&pollt.lock);
+  for(i = 0; i < NPOLLER; i++)
+    if(q->w[i]){
+      q->w[i]->woken = 1;
+      wakeup(q->w[i]);
+    }
+  release(&pollt.lock);
+}
+
+// Take pw off all its wait queues.
+static void
+pollunwait(struct poller *pw)
+{
+  int i, j;
+
+  acquire(&pollt.lock);
+  for(i = 0; i < pw->nq; i++)
+    for(j = 0; j < NPOLLER; j++)
+      if(pw->q[i]->w[j] == pw)
+        pw->q[i]->w[j] = 0;
+  pw->nq = 0;
+  release(&pollt.lock);
+}
+
+// Fill in revents for the n entries of fds, waiting until one
+// is ready, for at most timeout ticks unless timeout is
+// negative.  Returns how many entries have revents set, or -1
+// if the process was killed.
+int
+poll(struct pollfd *fds, int n, int timeout)
+{
+  struct proc *p = myproc();
+  struct file *f[NOFILE];
+  struct poller pw;
+  uint start = ticks;
+  int i, r, ready;
+
+  for(i = 0; i < n; i++){
+    f[i] = 0;
+    fds[i].revents = 0;
+    if(fds[i].fd < 0)
+      continue;
+    // A reference, so that a close by another thread cannot
+    // free a wait queue we are on.
+    if((f[i] = fdget(p->fdt, fds[i].fd)) == 0)
+      fds[i].revents = POLLNVAL;
+  }
+
+  memset(&pw, 0, sizeof(pw));
+  for(;;){
+    ready = 0;
+    for(i = 0; i < n; i++){
+      if(f[i]){
+        r = filepoll(f[i], ready ? 0 : &pw);
+        fds[i].revents = r & (fds[i].events | POLLERR | POLLHUP);
+      }
+      if(fds[i].revents)
+        ready++;
+    }
+    if(ready || timeout == 0 || p->killed)
+      break;
+    if(timeout > 0 && ticks - start >= timeout)
+      break;
+
+    // Without a place on some queue, look again every tick.
+    acquire(&pollt.lock);
+    if(!pw.woken){
+      if(pw.full)
+        sleeptimed(&pw, &pollt.lock, 1);
+      else if(timeout > 0)
+        sleeptimed(&pw, &pollt.lock, timeout - (ticks - start));
+      else
+        sleep(&pw, &pollt.lock);
+    }
+    release(&pollt.lock);
+    pollunwait(&pw);
+    pw.woken = pw.full = 0;
+  }
+  pollunwait(&pw);
+
+  for(i = 0; i < n; i++)
+    if(f[i])
+      fileclose(f[i]);
+  return p->killed ? -1 : ready;
+}
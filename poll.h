@@ -0,0 +1,12 @@
+// poll() (poll.c).
+#define POLLIN   0x001  // a read would not wait
+#define POLLOUT  0x004  // a write would not wait
+#define POLLERR  0x008  // writes fail: no reader (always reported)
+#define POLLHUP  0x010  // no writer left (always reported)
+#define POLLNVAL 0x020  // fd is not open (always reported)
+
+struct pollfd {
+	int fd;         // ignored if negative
+	short events;   // POLLIN and/or POLLOUT
+	short revents;  // what is ready, filled in by poll()
+};
@@ -6,25 +6,45 @@
 #include "x86.h"
 #include "proc.h"
 #include "spinlock.h"
+#include "sleeplock.h"
+#include "fs.h"
+#include "file.h"
 #include "pinfo.h"
+#include "rusage.h"
+#include "cpustat.h"
+#include "sched.h"
+#include "trace.h"
+#include "spawn.h"
 
-struct {
-  struct spinlock lock;
-  struct proc proc[NPROC];
-} ptable;
+struct ptable ptable;
 
 static struct proc *initproc;
 
+// Locks for page tables shared by threads.  A page table uses
+// the entry its address picks, so unrelated processes seldom
+// wait for each other.
+static struct {
+  struct sleeplock grow;  // serializes growproc()
+  struct spinlock pin;    // protects pin[] of the processes
+} vmlocks[NVMLOCK];
+
 int nextpid = 1;
 extern void forkret(void);
 extern void trapret(void);
 
 static void wakeup1(void *chan);
+static void setsz(pde_t *pgdir, uint sz);
 
 void
 pinit(void)
 {
+  int i;
+
   initlock(&ptable.lock, "ptable");
+  for(i = 0; i < NVMLOCK; i++){
+    initsleeplock(&vmlocks[i].grow, "vm");
+    initlock(&vmlocks[i].pin, "vmpin");
+  }
 }
 
 // Must be called with interrupts disabled
@@ -89,6 +109,8 @@ allocproc(void)
 found:
   p->state = EMBRYO;
   p->pid = nextpid++;
+  p->pgdir = 0;
+  p->wakeat = 0;
   p->ctime = ticks;
   p->etime = -1;
   p->rtime = 0;
@@ -97,20 +119,31 @@ found:
   p->curr_wtime=0;
   p->curr_rtime=0;
   p->priority = 60;
+  p->base_priority = 60;
+  p->waitlock = 0;
   p->curr_q=0;
-#if SCHEDULER != PBS_SCHED
-  p->priority = -1;
-#endif
-#if SCHEDULER != MLFQ_SCHED
-  p->curr_q = -1;
-#endif
-  for(int i=0;i<QCNT;i++){
+  for(int i=0;i<QCNT;i++)
     p->ticks_inq[i]=0;
-#if SCHEDULER != MLFQ_SCHED
-  	p->ticks_inq[i]=-1;
-#endif
-  }
+  p->vruntime = 0;
+  p->pass = 0;
+  p->rqidx = -1;
+  p->dl_runtime = 0;
+  p->dl_throttled = 0;
+  p->dl_misses = 0;
+  p->cpumask = ~0;
+  p->lastcpu = -1;
+  p->vmshared = 0;
+  p->npin = 0;
+  p->fdt = 0;
+  p->nfhold = 0;
   p->used_limit=0;
+  p->allot_used=0;
+  p->nvcsw = p->nivcsw = 0;
+  p->nsyscalls = p->npgfaults = 0;
+  p->rbytes = p->wbytes = 0;
+  p->rblocks = p->wblocks = 0;
+  p->cputime = 0;
+  memset(p->rqwait, 0, sizeof(p->rqwait));
 
   release(&ptable.lock);
 
@@ -161,6 +194,8 @@ userinit(void)
   p->tf->eflags = FL_IF;
   p->tf->esp = PGSIZE;
   p->tf->eip = 0;  // beginning of initcode.S
+  if((p->fdt = fdtalloc()) == 0)
+    panic("userinit: no file table");
 
   safestrcpy(p->name, "initcode", sizeof(p->name));
   p->cwd = namei("/");
@@ -172,33 +207,205 @@ userinit(void)
   acquire(&ptable.lock);
 
   p->state = RUNNABLE;
-#if SCHEDULER == MLFQ_SCHED
-  pushq(0, p);
-  p->curr_q = 0;
-#endif
+  sched_wakeup(p);
 
   release(&ptable.lock);
 }
 
+static struct sleeplock*
+vmgrowlock(pde_t *pgdir)
+{
+  return &vmlocks[(uint)pgdir / PGSIZE % NVMLOCK].grow;
+}
+
+static struct spinlock*
+vmpinlock(pde_t *pgdir)
+{
+  return &vmlocks[(uint)pgdir / PGSIZE % NVMLOCK].pin;
+}
+
+// Pinning user memory.
+//
+// A system call that has checked a user pointer (checkptr() and
+// friends) pins the range until it returns, and a thread about
+// to take memory off the page table, by sbrk(-n), munmap() or
+// shmdt(), fails if another thread has any of it pinned.  So
+// the kernel never faults on checked memory, which it could not
+// survive.  The pin goes in before the check, while taking
+// memory away looks for pins and makes the range fail the check
+// under one lock that the check also takes, so one of the two
+// always sees the other.  A process alone on its page table
+// needs no pins.
+
+// Whether a process on pgdir other than the current one has
+// pinned part of [lo, hi).  Caller holds vmpinlock(pgdir).
+static int
+pinned(pde_t *pgdir, uint lo, uint hi)
+{
+  struct proc *p;
+  int i;
+
+  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
+    if(p == myproc() || p->pgdir != pgdir)
+      continue;
+    for(i = 0; i < p->npin; i++)
+      if(p->pin[i][0] < hi && lo < p->pin[i][1])
+        return 1;
+  }
+  return 0;
+}
+
+// Pin [addr, addr+n) of the current process until uvmunpin().
+// Returns -1 if the range wraps around.
+int
+uvmpin(uint addr, uint n)
+{
+  struct proc *p = myproc();
+  uint *r;
+  int i;
+
+  if(addr + n < addr)
+    return -1;
+  if(!p->vmshared || n == 0)
+    return 0;
+  acquire(vmpinlock(p->pgdir));
+  // Arguments are next to each other on the stack: widen an
+  // entry that the range touches, or, out of entries, the last.
+  for(i = 0; i < p->npin; i++)
+    if(p->pin[i][0] <= addr + n && addr <= p->pin[i][1])
+      break;
+  if(i == p->npin && p->npin < NPIN){
+    r = p->pin[p->npin++];
+    r[0] = addr;
+    r[1] = addr + n;
+  } else {
+    r = p->pin[i < p->npin ? i : NPIN-1];
+    if(addr < r[0])
+      r[0] = addr;
+    if(addr + n > r[1])
+      r[1] = addr + n;
+  }
+  release(vmpinlock(p->pgdir));
+  return 0;
+}
+
+// Drop the pins of the current process.
+void
+uvmunpin(void)
+{
+  struct proc *p = myproc();
+
+  if(p->npin == 0)
+    return;
+  acquire(vmpinlock(p->pgdir));
+  p->npin = 0;
+  release(vmpinlock(p->pgdir));
+}
+
+// Whether another process on pgdir has pinned part of
+// [lo, hi).  A caller taking the range away holds the lock
+// that checking a pointer into it takes (mm.lock, shm.lock)
+// from this call until the range is gone.
+int
+uvmpinned(pde_t *pgdir, uint lo, uint hi)
+{
+  int r;
+
+  acquire(vmpinlock(pgdir));
+  r = pinned(pgdir, lo, hi);
+  release(vmpinlock(pgdir));
+  return r;
+}
+
 // Grow current process's memory by n bytes.
-// Return 0 on success, -1 on failure.
+// Return the old size on success, -1 on failure, which
+// includes shrinking over memory that another thread's system
+// call has pinned.
 int
 growproc(int n)
 {
-  uint sz;
+  uint sz, oldsz;
   struct proc *curproc = myproc();
+  pde_t *pgdir = curproc->pgdir;
 
-  sz = curproc->sz;
+  acquiresleep(vmgrowlock(pgdir));
+  sz = oldsz = curproc->sz;
   if(n > 0){
-    if((sz = allocuvm(curproc->pgdir, sz, sz + n)) == 0)
+    if((sz = allocuvm(pgdir, sz, sz + n)) == 0){
+      releasesleep(vmgrowlock(pgdir));
       return -1;
+    }
+    setsz(pgdir, sz);
   } else if(n < 0){
-    if((sz = deallocuvm(curproc->pgdir, sz, sz + n)) == 0)
+    // Shrink sz first, so that other threads stop handing the
+    // kernel pointers into the pages about to go.  shrinkuvm()
+    // cannot fail from here on.
+    sz += n;
+    acquire(vmpinlock(pgdir));
+    if(-n > oldsz || pinned(pgdir, sz, oldsz)){
+      release(vmpinlock(pgdir));
+      releasesleep(vmgrowlock(pgdir));
       return -1;
+    }
+    setsz(pgdir, sz);
+    release(vmpinlock(pgdir));
+    shrinkuvm(pgdir, oldsz, sz);
   }
+  releasesleep(vmgrowlock(pgdir));
+  switchuvm(curproc);
+  return oldsz;
+}
+
+// Set the size of every process on page table pgdir.
+static void
+setsz(pde_t *pgdir, uint sz)
+{
+  struct proc *p;
+
+  acquire(&ptable.lock);
+  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++)
+    if(p->state != UNUSED && p->pgdir == pgdir)
+      p->sz = sz;
+  release(&ptable.lock);
+}
+
+// Number of processes other than self on page table pgdir.
+// Caller must hold ptable.lock.
+static int
+vmusers(pde_t *pgdir, struct proc *self)
+{
+  struct proc *p;
+  int n = 0;
+
+  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++)
+    if(p != self && p->state != UNUSED && p->pgdir == pgdir)
+      n++;
+  return n;
+}
+
+// Switch the current process to page table pgdir of size sz
+// (for exec), and free the old one unless a thread still runs
+// on it.  freevm() may sleep (see mmap.c), so it is called
+// without ptable.lock, but the decision is made under it.
+void
+execvm(pde_t *pgdir, uint sz)
+{
+  struct proc *curproc = myproc();
+  pde_t *old;
+  int n;
+
+  // The new page table is the process's alone.
+  uvmunpin();
+  curproc->vmshared = 0;
+  acquire(&ptable.lock);
+  old = curproc->pgdir;
+  curproc->pgdir = pgdir;
   curproc->sz = sz;
+  n = vmusers(old, 0);
+  release(&ptable.lock);
   switchuvm(curproc);
-  return 0;
+  if(n == 0)
+    freevm(old);
 }
 
 // Create a new process copying p as the parent.
@@ -207,7 +414,8 @@ growproc(int n)
 int
 fork(void)
 {
-  int i, pid;
+  int pid;
+  uint sz;
   struct proc *np;
   struct proc *curproc = myproc();
 
@@ -216,23 +424,33 @@ fork(void)
     return -1;
   }
 
-  // Copy process state from proc.
-  if((np->pgdir = copyuvm(curproc->pgdir, curproc->sz)) == 0){
+  // Copy process state from proc, which other threads must not
+  // shrink meanwhile.
+  sz = curproc->sz;
+  uvmpin(0, sz);
+  if((np->pgdir = copyuvm(curproc->pgdir, sz)) == 0){
     kfree(np->kstack);
     np->kstack = 0;
     np->state = UNUSED;
     return -1;
   }
-  np->sz = curproc->sz;
+  if(shmfork(curproc->pgdir, np->pgdir) < 0 ||
+     mmapfork(curproc->pgdir, np->pgdir) < 0 ||
+     (np->fdt = fdtcopy(curproc->fdt)) == 0){
+    freevm(np->pgdir);
+    np->pgdir = 0;
+    kfree(np->kstack);
+    np->kstack = 0;
+    np->state = UNUSED;
+    return -1;
+  }
+  np->sz = sz;
   np->parent = curproc;
   *np->tf = *curproc->tf;
 
   // Clear %eax so that fork returns 0 in the child.
   np->tf->eax = 0;
 
-  for(i = 0; i < NOFILE; i++)
-    if(curproc->ofile[i])
-      np->ofile[i] = filedup(curproc->ofile[i]);
   np->cwd = idup(curproc->cwd);
 
   safestrcpy(np->name, curproc->name, sizeof(curproc->name));
@@ -241,16 +459,227 @@ fork(void)
 
   acquire(&ptable.lock);
 
+  np->priority = np->base_priority = curproc->base_priority;
+  np->cpumask = curproc->cpumask;
   np->state = RUNNABLE;
-#if SCHEDULER == MLFQ_SCHED
-  pushq(0, np);
-  np->curr_q = 0;
-#endif
+  sched_wakeup(np);
   release(&ptable.lock);
 
   return pid;
 }
 
+// Create a thread: a process sharing the caller's page table,
+// that starts running fn(arg1, arg2) on the PGSIZE-byte user
+// stack at stack.  It shares the open file table too.
+// The caller must reap it with join(), not wait().
+int
+clone(void (*fn)(void*, void*), void *arg1, void *arg2, void *stack)
+{
+  int pid;
+  uint sp, ustack[3];
+  struct proc *np;
+  struct proc *curproc = myproc();
+
+  // From now on the caller and the new thread share the page
+  // table, so both must pin memory they hand the kernel.
+  curproc->vmshared = 1;
+  if((uint)stack % sizeof(uint) != 0 || uvmpin((uint)stack, PGSIZE) < 0 ||
+     (uint)stack + PGSIZE > curproc->sz)
+    return -1;
+
+  // Allocate process.
+  if((np = allocproc()) == 0){
+    return -1;
+  }
+
+  // Arguments and a fake return PC, as if fn had been called.
+  sp = (uint)stack + PGSIZE;
+  ustack[0] = 0xffffffff;
+  ustack[1] = (uint)arg1;
+  ustack[2] = (uint)arg2;
+  sp -= sizeof(ustack);
+  if(copyout(curproc->pgdir, sp, ustack, sizeof(ustack)) < 0){
+    kfree(np->kstack);
+    np->kstack = 0;
+    np->state = UNUSED;
+    return -1;
+  }
+
+  np->parent = curproc;
+  np->ustack = stack;
+  *np->tf = *curproc->tf;
+  np->tf->eip = (uint)fn;
+  np->tf->esp = sp;
+
+  np->fdt = fdtdup(curproc->fdt);
+  np->cwd = idup(curproc->cwd);
+
+  safestrcpy(np->name, curproc->name, sizeof(curproc->name));
+
+  pid = np->pid;
+
+  acquire(&ptable.lock);
+
+  // Under ptable.lock, so that growproc() sees np with the
+  // page table or updates its size.
+  np->pgdir = curproc->pgdir;
+  np->sz = curproc->sz;
+  np->vmshared = 1;
+  np->priority = np->base_priority = curproc->base_priority;
+  np->cpumask = curproc->cpumask;
+  np->state = RUNNABLE;
+  sched_wakeup(np);
+  release(&ptable.lock);
+
+  return pid;
+}
+
+// A kernel thread's very first scheduling by scheduler()
+// will swtch here, instead of forkret.
+static void
+kthreadret(void)
+{
+  // Still holding ptable.lock from scheduler.
+  release(&ptable.lock);
+  myproc()->kfn();
+  panic("kthread return");
+}
+
+// Create a kernel thread that runs fn(), which must end in
+// exit().  It has no user context of its own but runs on page
+// table pgdir, so it can reach that address space's memory,
+// and init reaps it.  Does not sleep.  Returns 0 on failure.
+struct proc*
+kthread(char *name, void (*fn)(void), pde_t *pgdir)
+{
+  struct proc *np;
+  struct proc *curproc = myproc();
+
+  if((np = allocproc()) == 0)
+    return 0;
+  np->context->eip = (uint)kthreadret;
+  np->kfn = fn;
+  np->parent = initproc;
+  np->cwd = idup(curproc->cwd);
+  safestrcpy(np->name, name, sizeof(np->name));
+
+  np->vmshared = 1;
+  if(pgdir == curproc->pgdir)
+    curproc->vmshared = 1;
+  acquire(&ptable.lock);
+  np->pgdir = pgdir;
+  np->sz = curproc->sz;
+  np->priority = np->base_priority = curproc->base_priority;
+  np->state = RUNNABLE;
+  sched_wakeup(np);
+  release(&ptable.lock);
+  return np;
+}
+
+// Do file action a on the file table of np, which is being
+// spawned.
+static int
+spawnact(struct proc *np, struct spawnact *a)
+{
+  struct file **ofile = np->fdt->ofile;
+  struct file *f;
+
+  if(a->fd < 0 || a->fd >= NOFILE)
+    return -1;
+  switch(a->op){
+  case SPAWN_CLOSE:
+    if(ofile[a->fd]){
+      fileclose(ofile[a->fd]);
+      ofile[a->fd] = 0;
+    }
+    return 0;
+  case SPAWN_DUP2:
+    if(a->newfd < 0 || a->newfd >= NOFILE || ofile[a->fd] == 0)
+      return -1;
+    if(a->newfd != a->fd){
+      f = filedup(ofile[a->fd]);
+      if(ofile[a->newfd])
+        fileclose(ofile[a->newfd]);
+      ofile[a->newfd] = f;
+    }
+    return 0;
+  case SPAWN_OPEN:
+    if((f = fileopen(a->path, a->mode)) == 0)
+      return -1;
+    if(ofile[a->fd])
+      fileclose(ofile[a->fd]);
+    ofile[a->fd] = f;
+    return 0;
+  }
+  return -1;
+}
+
+// Create a child running program path with arguments argv,
+// loaded straight from the ELF file rather than exec'd over a
+// copy of the current process.  The child gets the parent's open
+// files with the nact actions in act done on them, before the
+// program is loaded, as if by a forked child before exec().
+// Returns the child's pid, -2-i if action i failed, or -1.
+int
+spawn(char *path, char **argv, struct spawnact *act, int nact)
+{
+  int i, pid, err = -1;
+  uint eip, sp;
+  struct proc *np;
+  struct proc *curproc = myproc();
+
+  if((np = allocproc()) == 0)
+    return -1;
+  if((np->fdt = fdtcopy(curproc->fdt)) == 0)
+    goto bad;
+  for(i = 0; i < nact; i++)
+    if(spawnact(np, &act[i]) < 0){
+      err = -2-i;
+      goto bad;
+    }
+  if(loaduser(path, argv, &np->pgdir, &np->sz, &eip, &sp) < 0)
+    goto bad;
+  np->cwd = idup(curproc->cwd);
+  np->parent = curproc;
+
+  memset(np->tf, 0, sizeof(*np->tf));
+  np->tf->cs = (SEG_UCODE << 3) | DPL_USER;
+  np->tf->ds = (SEG_UDATA << 3) | DPL_USER;
+  np->tf->es = np->tf->ds;
+  np->tf->ss = np->tf->ds;
+  np->tf->eflags = FL_IF;
+  np->tf->eip = eip;
+  np->tf->esp = sp;
+
+  safestrcpy(np->name, progname(path), sizeof(np->name));
+
+  pid = np->pid;
+
+  acquire(&ptable.lock);
+
+  np->priority = np->base_priority = curproc->base_priority;
+  np->cpumask = curproc->cpumask;
+  np->state = RUNNABLE;
+  sched_wakeup(np);
+  release(&ptable.lock);
+
+  return pid;
+
+ bad:
+  if(np->fdt){
+    fdtput(np->fdt);
+    np->fdt = 0;
+  }
+  if(np->pgdir){
+    freevm(np->pgdir);
+    np->pgdir = 0;
+  }
+  kfree(np->kstack);
+  np->kstack = 0;
+  np->state = UNUSED;
+  return err;
+}
+
 // Exit the current process.  Does not return.
 // An exited process remains in the zombie state
 // until its parent calls wait() to find out it exited.
@@ -259,20 +688,21 @@ exit(void)
 {
   struct proc *curproc = myproc();
   struct proc *p;
-  int fd;
 
   if(curproc == initproc)
     panic("init exiting");
 
+  uringexit(curproc);
+  uvmunpin();
+
   // Setting up end_time of the process
   curproc->etime = ticks;
 
-  // Close all open files.
-  for(fd = 0; fd < NOFILE; fd++){
-    if(curproc->ofile[fd]){
-      fileclose(curproc->ofile[fd]);
-      curproc->ofile[fd] = 0;
-    }
+  // Close all open files, unless other threads still use them.
+  fdrelease();
+  if(curproc->fdt){
+    fdtput(curproc->fdt);
+    curproc->fdt = 0;
   }
 
   begin_op();
@@ -296,6 +726,7 @@ exit(void)
 
   // Jump into the scheduler, never to return.
   curproc->state = ZOMBIE;
+  schedtrace(TR_EXIT, curproc, sched_tracearg(curproc));
   sched();
   panic("zombie exit");
 }
@@ -306,6 +737,7 @@ int
 wait(void)
 {
   struct proc *p;
+  pde_t *pgdir;
   int havekids, pid;
   struct proc *curproc = myproc();
   
@@ -314,21 +746,25 @@ wait(void)
     // Scan through table looking for exited children.
     havekids = 0;
     for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-      if(p->parent != curproc)
-        continue;
+      if(p->parent != curproc || p->pgdir == curproc->pgdir)
+        continue;  // threads are for join()
       havekids = 1;
       if(p->state == ZOMBIE){
         // Found one.
         pid = p->pid;
         kfree(p->kstack);
         p->kstack = 0;
-        freevm(p->pgdir);
+        // The last user frees the page table, after releasing
+        // ptable.lock because freevm() may sleep.
+        pgdir = vmusers(p->pgdir, p) == 0 ? p->pgdir : 0;
         p->pid = 0;
         p->parent = 0;
         p->name[0] = 0;
         p->killed = 0;
         p->state = UNUSED;
         release(&ptable.lock);
+        if(pgdir)
+          freevm(pgdir);
         return pid;
       }
     }
@@ -344,8 +780,27 @@ wait(void)
   }
 }
 
-int waitx(int *wtime, int *rtime) {
-	int havekids, pid;
+// Copy the counters of p into ru.
+static void getrusage(struct proc *p, struct rusage *ru) {
+	ru->rtime = p->rtime;
+	ru->wtime = p->tot_wtime;
+	ru->nvcsw = p->nvcsw;
+	ru->nivcsw = p->nivcsw;
+	ru->nsyscalls = p->nsyscalls;
+	ru->npgfaults = p->npgfaults;
+	ru->rbytes = p->rbytes;
+	ru->wbytes = p->wbytes;
+	ru->rblocks = p->rblocks;
+	ru->wblocks = p->wblocks;
+	memmove(ru->rqwait, p->rqwait, sizeof(ru->rqwait));
+}
+
+// Wait for child pid (any child if pid is -1) to exit, fill in
+// its resource usage and return its pid.
+// Return -1 if there is no such child.
+int wait4(int pid, struct rusage *ru) {
+	pde_t *pgdir;
+	int havekids;
 	struct proc *curproc = myproc();
 
 	acquire(&ptable.lock);
@@ -353,23 +808,26 @@ int waitx(int *wtime, int *rtime) {
 		// Scan through table looking for exited children.
 		havekids = 0;
 		for (struct proc *p = ptable.proc; p < &ptable.proc[NPROC]; p++) {
-			if (p->parent != curproc)
+			if (p->parent != curproc || p->pgdir == curproc->pgdir ||
+				(pid != -1 && p->pid != pid))
 				continue;
 			havekids = 1;
 			if (p->state == ZOMBIE) {
 				// Found one.
 				pid = p->pid;
-				*rtime = p->rtime;
-				*wtime = p->tot_wtime;
+				getrusage(p, ru);
 				kfree(p->kstack);
 				p->kstack = 0;
-				freevm(p->pgdir);
+				// As in wait().
+				pgdir = vmusers(p->pgdir, p) == 0 ? p->pgdir : 0;
 				p->pid = 0;
 				p->parent = 0;
 				p->name[0] = 0;
 				p->killed = 0;
 				p->state = UNUSED;
 				release(&ptable.lock);
+				if (pgdir)
+					freevm(pgdir);
 				return pid;
 			}
 		}
@@ -385,6 +843,69 @@ int waitx(int *wtime, int *rtime) {
 	}
 }
 
+// Wait for a thread created by clone() to exit, store the stack
+// it was given in *stack and return its pid.
+// Return -1 if this process has no threads.
+int
+join(void **stack)
+{
+  struct proc *p;
+  int havekids, pid;
+  struct proc *curproc = myproc();
+
+  acquire(&ptable.lock);
+  for(;;){
+    // Scan through table looking for exited threads.
+    havekids = 0;
+    for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
+      if(p->parent != curproc || p->pgdir != curproc->pgdir)
+        continue;
+      havekids = 1;
+      if(p->state == ZOMBIE){
+        // Found one.  The page table is still ours.
+        pid = p->pid;
+        *stack = p->ustack;
+        kfree(p->kstack);
+        p->kstack = 0;
+        p->pid = 0;
+        p->parent = 0;
+        p->name[0] = 0;
+        p->killed = 0;
+        p->state = UNUSED;
+        release(&ptable.lock);
+        return pid;
+      }
+    }
+
+    // No point waiting if we don't have any threads.
+    if(!havekids || curproc->killed){
+      release(&ptable.lock);
+      return -1;
+    }
+
+    sleep(curproc, &ptable.lock);
+  }
+}
+
+int waitx(int *wtime, int *rtime) {
+	struct rusage ru;
+	int pid = wait4(-1, &ru);
+
+	if (pid >= 0) {
+		*wtime = ru.wtime;
+		*rtime = ru.rtime;
+	}
+	return pid;
+}
+
+// Run queue wait histogram bucket for c cycles.
+static uint
+rqbucket(uint64 c)
+{
+  uint i = msb64(c);
+  return i < NRUHIST ? i : NRUHIST-1;
+}
+
 //PAGEBREAK: 42
 // Per-CPU process scheduler.
 // Each CPU calls scheduler() after setting itself up.
@@ -400,28 +921,29 @@ scheduler(void)
   struct cpu *c = mycpu();
   c->proc = 0;
   
-#if SCHEDULER == RR_SCHED
-
   for(;;){
     // Enable interrupts on this processor.
     sti();
 
-    // Loop over process table looking for process to run.
+    // Ask the scheduling class for a process to run (sched.c).
     acquire(&ptable.lock);
-    for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-      if(p->state != RUNNABLE)
-        continue;
-
+    if((p = sched_pick(c)) != 0){
       // Switch to chosen process.  It is the process's job
       // to release ptable.lock and then reacquire it
       // before jumping back to us.
 #ifdef DEBUG
-	  cprintf("RR  cpu: %d pid: %d name: %s\n", c - cpus, p->pid, p->name);
+      cprintf("cpu: %d pid: %d name: %s pty: %d\n", c - cpus, p->pid, p->name, p->priority);
 #endif
-	    c->proc = p;
+      c->proc = p;
       switchuvm(p);
       p->state = RUNNING;
       p->rn_cnt++;
+      p->curr_rtime = 0;
+      p->lastcpu = c - cpus;
+      p->tdispatch = rdtsc();
+      p->rqwait[rqbucket(p->tdispatch - p->trunnable)]++;
+      cpuacct(CPU_KERNEL);
+      schedtrace(TR_DISPATCH, p, sched_tracearg(p));
 
       swtch(&(c->scheduler), p->context);
       switchkvm();
@@ -429,147 +951,13 @@ scheduler(void)
       // Process is done running for now.
       // It should have changed its p->state before coming back.
       c->proc = 0;
+      p->cputime += rdtsc() - p->tdispatch;
+      sched_put(p);
+    } else {
+      cpuacct(CPU_IDLE);
     }
     release(&ptable.lock);
-	}
-
-#elif SCHEDULER == FCFS_SCHED
-
-  for(;;){
-    // Enable interrupts on this processor.
-    sti();
-
-    // Loop over process table looking for process to run.
-    acquire(&ptable.lock);
-    int min_ctime=0;
-    p = 0;
-    for (int i=0; i<NPROC; i++) {
-		if (ptable.proc[i].state != RUNNABLE)
-			continue;
-		if (ptable.proc[i].ctime < min_ctime || !p) {
-			min_ctime = ptable.proc[i].ctime;
-			p = ptable.proc + i;
-      }
-    }
-
-    if(p){
-#ifdef DEBUG
-		cprintf("FCFS  cpu: %d pid: %d name: %s\n", c - cpus, p->pid, p->name);
-#endif
-
-      c->proc = p;
-      switchuvm(p);
-      p->state = RUNNING;
-      p->rn_cnt++;
-      swtch(&(c->scheduler), p->context);
-      switchkvm();
-
-      // Process is done running for now.
-      // It should have changed its p->state before coming back.
-      c->proc = 0;
-	  }
-    release(&ptable.lock);
-	}
-
-#elif SCHEDULER == PBS_SCHED
-
-  for (;;) {
-	  // Enable interrupts on this processor.
-	  sti();
-
-	  // Loop over process table looking for process to run.
-	  acquire(&ptable.lock);
-	  int high_pty = 101;
-	  p = 0;
-	  for (int i = 0; i < NPROC; i++) {
-		  if (ptable.proc[i].state != RUNNABLE)
-			  continue;
-		  if (!p || ptable.proc[i].priority < high_pty ||
-			  (ptable.proc[i].priority == high_pty && ptable.proc[i].rn_cnt < p->rn_cnt)) {
-			  high_pty = ptable.proc[i].priority;
-			  p = ptable.proc + i;
-		  }
-	  }
-
-	  if (p) {
-#ifdef DEBUG
-		  cprintf("PBS  cpu: %d pid: %d(%d) name: %s pty: %d \n",
-				  c - cpus, p->pid, p->parent ? p->parent->pid : 0, p->name, p->priority);
-#endif
-
-		  p->rn_cnt++;
-		  c->proc = p;
-		  switchuvm(p);
-		  p->state = RUNNING;
-		  swtch(&(c->scheduler), p->context);
-		  switchkvm();
-
-		  // Process is done running for now.
-		  // It should have changed its p->state before coming back.
-		  c->proc = 0;
-	  }
-	  release(&ptable.lock);
   }
-
-#elif SCHEDULER == MLFQ_SCHED
-  for (;;) {
-	  // Enable interrupts on this processor.
-	  sti();
-	  acquire(&ptable.lock);
-	  struct proc *selcp = 0;
-
-    //select from fronts and if not runnable rem from queue
-    // queue should only store runnable procs
-	  for(int i=0; i<QCNT; i++){
-      p = frontq(i);
-      if(p){
-        remq(i, p);
-        if( p->state == RUNNABLE){
-          selcp =p;
-          break;
-        } else i--;
-      }
-    }
-    // cprintf("SELECTED 0: %d\n", selcp ==0);
-    if(selcp){
-      selcp->rn_cnt++;
-      selcp->curr_wtime=0;
-      selcp->curr_rtime=1;
-      selcp->ticks_inq[selcp->curr_q]++;
-#ifdef LOGS
-      cprintf("%d %d %d::=\n", ticks, selcp->pid, selcp->curr_q);
-#endif
-      c->proc = selcp;
-
-      switchuvm(selcp);
-      selcp->state = RUNNING;
-      swtch(&(c->scheduler), selcp->context);
-      switchkvm();
-
-      // Process is done running for now.
-      // It should have changed its selcp->state before coming back.
-      c->proc = 0;
-
-      if(selcp && selcp->state == RUNNABLE){
-          if(selcp->used_limit && selcp->curr_q < QCNT-1){
-            selcp->used_limit=0;
-            selcp->curr_q++;
-            selcp->curr_wtime=0;
-            #ifdef DEBUG
-              cprintf("Proc: %s (%d) queue inc: %d\n",selcp->name, selcp->pid, selcp->curr_q);
-            #endif
-#ifdef LOGS
-  cprintf("%d %d %d::=\n", ticks,selcp->pid, selcp->curr_q);
-#endif
-          }
-          selcp->curr_rtime=0;
-          pushq(selcp->curr_q, selcp);
-        }
-  	}
-	release(&ptable.lock);
-  }
-
-#endif 
 }
 
 // Enter scheduler.  Must hold only ptable.lock
@@ -604,6 +992,9 @@ yield(void)
 {
   acquire(&ptable.lock);  //DOC: yieldlock
   myproc()->state = RUNNABLE;
+  myproc()->nivcsw++;
+  myproc()->trunnable = rdtsc();
+  schedtrace(TR_PREEMPT, myproc(), sched_tracearg(myproc()));
   sched();
   release(&ptable.lock);
 }
@@ -627,6 +1018,7 @@ forkret(void)
   }
 
   // Return to "caller", actually trapret (see allocproc).
+  cpuacct(CPU_USER);
 }
 
 // Atomically release lock and sleep on chan.
@@ -655,6 +1047,8 @@ sleep(void *chan, struct spinlock *lk)
   // Go to sleep.
   p->chan = chan;
   p->state = SLEEPING;
+  p->nvcsw++;
+  schedtrace(TR_SLEEP, p, sched_tracearg(p));
 
   sched();
 
@@ -669,6 +1063,60 @@ sleep(void *chan, struct spinlock *lk)
 }
 
 //PAGEBREAK!
+// Like sleep, but also wake up after timeout ticks unless
+// timeout is 0.  Returns -1 if it timed out, 0 otherwise.
+int
+sleeptimed(void *chan, struct spinlock *lk, uint timeout)
+{
+  struct proc *p = myproc();
+
+  p->timedout = 0;
+  if(timeout)
+    p->wakeat = (ticks + timeout) | 1;  // 0 means no timeout
+  sleep(chan, lk);
+  p->wakeat = 0;
+  return p->timedout ? -1 : 0;
+}
+
+// Wake up processes whose sleeptimed() timeout has passed.
+// Called on every tick.
+void
+wakeup_timeouts(void)
+{
+  struct proc *p;
+
+  acquire(&ptable.lock);
+  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++)
+    if(p->state == SLEEPING && p->wakeat && (int)(ticks - p->wakeat) >= 0){
+      p->wakeat = 0;
+      p->timedout = 1;
+      p->state = RUNNABLE;
+      schedtrace(TR_WAKEUP, p, sched_tracearg(p));
+      sched_wakeup(p);
+    }
+  release(&ptable.lock);
+}
+
+// Wake up at most n processes sleeping on chan and return
+// how many were woken.
+int
+wakeupn(void *chan, int n)
+{
+  struct proc *p;
+  int woken = 0;
+
+  acquire(&ptable.lock);
+  for(p = ptable.proc; p < &ptable.proc[NPROC] && woken < n; p++)
+    if(p->state == SLEEPING && p->chan == chan){
+      p->state = RUNNABLE;
+      schedtrace(TR_WAKEUP, p, sched_tracearg(p));
+      sched_wakeup(p);
+      woken++;
+    }
+  release(&ptable.lock);
+  return woken;
+}
+
 // Wake up all processes sleeping on chan.
 // The ptable lock must be held.
 static void
@@ -679,9 +1127,8 @@ wakeup1(void *chan)
   for(p = ptable.proc; p < &ptable.proc[NPROC]; p++)
     if(p->state == SLEEPING && p->chan == chan){
       p->state = RUNNABLE;
-#if SCHEDULER == MLFQ_SCHED
-	  pushq(p->curr_q, p);
-#endif
+      schedtrace(TR_WAKEUP, p, sched_tracearg(p));
+      sched_wakeup(p);
     }
 }
 
@@ -709,10 +1156,8 @@ kill(int pid)
       // Wake process from sleep if necessary.
       if(p->state == SLEEPING){
         p->state = RUNNABLE;
-#if SCHEDULER == MLFQ_SCHED
-        pushq(0, p);
-        p->curr_q=0;
-#endif        
+        schedtrace(TR_WAKEUP, p, sched_tracearg(p));
+        sched_wakeup(p);
       }
       release(&ptable.lock);
       return 0;
@@ -783,65 +1228,15 @@ int set_prioritiy(int new_priority, int pid) {
 			break;
 		}
 	}
-	release(&ptable.lock);
-	if (!pc)
+	if (!pc) {
+		release(&ptable.lock);
 		return -1;
-	int old_pty = pc->priority;
-	pc->priority = new_priority;
-	// if (old_pty != new_priority) {
-		// yield();
-	// }
-	return old_pty;
-}
-
-void pushq(int qid, struct proc *p) {
-	if (priorq[qid].size < 2 * NPROC) {
-#ifdef DEBUG
-  // cprintf("proc: %d added to q:%d\n", p->pid, qid);
-#endif
-		priorq[qid].p[priorq[qid].size++] = p;
-	}
-}
-
-void remq(int qid, struct proc *p) {
-	for (int i = 0; i < priorq[qid].size; i++)
-		if (priorq[qid].p[i]->pid == p->pid) {
-#ifdef DEBUG
-			// cprintf("proc: %d removed to q:%d\n", p->pid, qid);
-#endif
-			for (int j = i + 1; j < priorq[qid].size; j++)
-				priorq[qid].p[j - 1] = priorq[qid].p[j];
-			priorq[qid].size--;
-      priorq[qid].p[priorq[qid].size]=0;
-			return;
-		}
-}
-
-void age_procs() {
-	for (int i = 1; i < QCNT; i++) {
-		for (int j = 0; j < priorq[i].size; j++) {
-			if (priorq[i].p + j && priorq[i].p[j]->state == RUNNABLE &&
-				priorq[i].p[j]->curr_wtime > STARV_LIM) {
-				struct proc *p = priorq[i].p[j];
-				pushq(i - 1, p);
-				remq(i, p);
-				p->curr_q = i - 1;
-        #ifdef DEBUG
-          cprintf("proc: %s(%d) aged to q: %d\n", p->name, p->pid, p->curr_q);
-        #endif
-#ifdef LOGS
-		  cprintf("%d %d %d::=\n", ticks,p->pid, p->curr_q);
-#endif
-			}
-		}
 	}
-}
-
-struct proc *frontq(int qid) {
-	if (priorq[qid].size > 0) {
-		return priorq[qid].p[0];
-	}
-	return 0;
+	int old_pty = pc->base_priority;
+	pc->base_priority = new_priority;
+	release(&ptable.lock);
+	sched_inherit(pc); // may send a reschedule IPI
+	return old_pty;
 }
 
 int get_pinfos(struct pinfo *arg){
@@ -868,16 +1263,13 @@ int get_pinfos(struct pinfo *arg){
 		arg[n].pid = p->pid;
 		arg[n].n_run = p->rn_cnt;
 		arg[n].rtime = p->rtime;
-  #if SCHEDULER == PBS_SCHED
 		arg[n].priority = p->priority;
-  #else 
-    arg[n].priority = -1;
-  #endif
 
 		arg[n].cur_q = p->curr_q;
 		for (int i = 0; i < QCNT; i++) {
 			arg[n].ticks[i] = p->ticks_inq[i];
 		}
+		arg[n].dl_misses = p->dl_misses;
 		n++;
 	} 
 	release(&ptable.lock);
@@ -8,6 +8,8 @@ struct cpu {
   int ncli;                    // Depth of pushcli nesting.
   int intena;                  // Were interrupts enabled before pushcli?
   struct proc *proc;           // The process running on this cpu or null
+  volatile int need_resched;   // Reschedule IPI sent and not yet taken
+  volatile int tlbflush;       // TLB shootdown IPI sent and not yet taken
 };
 
 extern struct cpu cpus[NCPU];
@@ -36,6 +38,16 @@ enum procstate { UNUSED, EMBRYO, SLEEPING, RUNNABLE, RUNNING, ZOMBIE };
 
 #define QCNT 5
 #define STARV_LIM 24
+#define MLFQ_BOOST 200    // ticks between moving every process back to queue 0
+
+#define CFS_LATENCY 8     // ticks in which every runnable process should run
+#define CFS_MINGRAN 1     // shortest CFS time slice, in ticks
+#define NICE0_WEIGHT 1024 // CFS weight of the default priority (60)
+
+#define STRIDE1 (1 << 20) // stride scheduling: pass advance for 1 ticket
+
+#define EDF_MAXUTIL 950   // admissible real-time load per CPU, per mille
+#define EDF_MAXPERIOD (1 << 20) // longest real-time period, in ticks
 
 // Per-process state
 struct proc {
@@ -49,7 +61,9 @@ struct proc {
   struct context *context;     // swtch() here to run process
   void *chan;                  // If non-zero, sleeping on chan
   int killed;                  // If non-zero, have been killed
-  struct file *ofile[NOFILE];  // Open files
+  struct fdtable *fdt;         // Open files, shared by threads
+  struct file *fhold[NFDHOLD]; // files this system call uses, see argfd()
+  int nfhold;                  // entries of fhold[] in use
   struct inode *cwd;           // Current directory
   char name[16];               // Process name (debugging)
   uint ctime;				           // Process creation time
@@ -57,12 +71,51 @@ struct proc {
   uint rtime;				           // Process total run time
   uint tot_wtime;				       // Process time spent as runnable
   uint curr_wtime;             // time for which process is runnable since last run, or since q enter
-  uint curr_rtime;             // time since got latest cpu hold, only for mlfq
+  uint curr_rtime;             // time since got latest cpu hold
   uint priority;			         // priority for scheduer. in range [0,100]
+  uint base_priority;          // priority set by set_priority, before inheritance
+  struct sleeplock *waitlock;  // sleeplock the process is sleeping to acquire
   unsigned long long rn_cnt;   // no. of times got cpu
   int curr_q;                 // curr q in mlfq
   uint ticks_inq[QCNT];        // array of ticks received as runtime in q
   int used_limit;
+  uint allot_used;             // MLFQ: ticks run in curr_q since entering it
+  uint64 vruntime;             // CFS: weighted run time, in kcycles
+  uint64 exec_start;           // CFS: rdtsc when last dispatched
+  uint slice;                  // CFS: ticks allowed in this dispatch
+  uint64 pass;                 // STRIDE: virtual time of next dispatch
+  uint64 rqkey;                // run queue heap order, smallest first
+  uint rqweight;               // weight added to the run queue load
+  int rqidx;                   // index in the run queue heap, -1 if not queued
+  int dl_runtime;              // EDF: ticks of CPU per period, 0 if not real-time
+  int dl_period;               // EDF: period in ticks
+  int dl_deadline;             // EDF: deadline in ticks from period start
+  uint dl_abs;                 // EDF: absolute deadline of the current period
+  uint dl_next;                // EDF: start of the next period
+  int dl_budget;               // EDF: runtime left in the current period
+  int dl_throttled;            // EDF: budget used up, waiting for dl_next
+  uint dl_misses;              // EDF: deadlines passed with budget unused
+  uint cpumask;                // CPUs the process may run on, bit i for cpus[i]
+  int lastcpu;                 // cpus[] index it last ran on, -1 if none
+  void *ustack;                // Thread: user stack passed to clone()
+  void (*kfn)(void);           // Kernel thread: its body, see kthread()
+  int vmshared;                // threads may share its page table
+  uint pin[NPIN][2];           // user memory in use by this system call, see uvmpin()
+  int npin;                    // entries of pin[] in use
+  uint wakeat;                 // sleeptimed(): tick to give up sleeping, 0 if none
+  int timedout;                // sleeptimed(): woken by the timeout
+  uint nvcsw;                  // times it gave up the CPU to sleep
+  uint nivcsw;                 // times it was preempted
+  uint nsyscalls;              // system calls made
+  uint npgfaults;              // page faults taken
+  uint rbytes;                 // bytes returned by read()
+  uint wbytes;                 // bytes accepted by write()
+  uint rblocks;                // disk blocks read in on its behalf
+  uint wblocks;                // disk blocks written on its behalf
+  uint64 cputime;              // rdtsc cycles spent running
+  uint64 tdispatch;            // rdtsc when it was last dispatched
+  uint64 trunnable;            // rdtsc when it last became RUNNABLE
+  uint rqwait[NRUHIST];        // run queue waits, bucket i is [2^i, 2^(i+1)) cycles
 };
 
 // Process memory is laid out contiguously, low addresses first:
@@ -70,13 +123,3 @@ struct proc {
 //   original data and bss
 //   fixed-size stack
 //   expandable heap
-
-struct queue {
-	int size;
-	struct proc *p[NPROC * 2];
-} priorq[QCNT];
-
-void pushq(int qid, struct proc *p);
-void remq(int qid, struct proc *p);
-void age_procs();
-struct proc *frontq(int qid);
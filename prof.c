@@ -0,0 +1,106 @@
+// Sampling profiler.
+//
+// While profiling is enabled, every timer interrupt on every
+// CPU records the interrupted eip into that CPU's ring buffer.
+// Each ring has a single writer (its CPU, in trap(), with
+// interrupts off) and a single reader (profread(), serialized
+// by prof.lock), so recording a sample takes no lock.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "memlayout.h"
+#include "mmu.h"
+#include "proc.h"
+#include "x86.h"
+#include "spinlock.h"
+#include "prof.h"
+
+struct profcpu {
+  uint head;     // next slot to fill; written only by the owning CPU
+  uint tail;     // next slot to read; written only by profread()
+  uint dropped;  // samples lost because the ring was full
+  struct profsample buf[NPROFSAMPLE];
+};
+
+static struct {
+  struct spinlock lock;
+  int on;
+  struct profcpu cpu[NCPU];
+} prof;
+
+void
+profinit(void)
+{
+  initlock(&prof.lock, "prof");
+}
+
+// Record a sample of tf.  Called from trap() on timer interrupts.
+void
+profsample(struct trapframe *tf)
+{
+  struct profcpu *pc;
+  struct profsample *s;
+  struct proc *p;
+
+  if(!prof.on)
+    return;
+  pc = &prof.cpu[cpuid()];
+  if(pc->head - pc->tail >= NPROFSAMPLE){
+    pc->dropped++;
+    return;
+  }
+  p = myproc();
+  s = &pc->buf[pc->head % NPROFSAMPLE];
+  s->eip = tf->eip;
+  s->pid = p ? p->pid : 0;
+  s->cpu = cpuid();
+  s->user = (tf->cs&3) == DPL_USER;
+  // Publish the sample before the new head.
+  __sync_synchronize();
+  pc->head++;
+}
+
+// Turn profiling on or off.  Turning it on discards any
+// samples still buffered.  Returns the number of samples
+// dropped since profiling was last turned on.
+int
+profctl(int on)
+{
+  struct profcpu *pc;
+  int dropped;
+
+  acquire(&prof.lock);
+  dropped = 0;
+  for(pc = prof.cpu; pc < &prof.cpu[ncpu]; pc++){
+    dropped += pc->dropped;
+    if(on){
+      pc->tail = pc->head;
+      pc->dropped = 0;
+    }
+  }
+  prof.on = on;
+  release(&prof.lock);
+  return dropped;
+}
+
+// Move up to n buffered samples into buf.
+// Returns the number of samples copied.
+int
+profread(struct profsample *buf, int n)
+{
+  struct profcpu *pc;
+  int i;
+
+  acquire(&prof.lock);
+  i = 0;
+  for(pc = prof.cpu; pc < &prof.cpu[ncpu]; pc++){
+    while(i < n && pc->tail != pc->head){
+      __sync_synchronize();
+      buf[i++] = pc->buf[pc->tail % NPROFSAMPLE];
+      pc->tail++;
+    }
+  }
+  release(&prof.lock);
+  return i;
+}
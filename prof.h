@@ -0,0 +1,11 @@
+#define NPROFSAMPLE 1024  // samples buffered per CPU between profread() calls
+
+// One sample of the interrupted program counter,
+// taken by trap() on every timer interrupt while profiling is on.
+struct profsample {
+	uint eip;     // interrupted instruction
+	uint pid;     // running process, 0 if the CPU was in the scheduler
+	uchar cpu;    // CPU that took the sample
+	uchar user;   // 1 if the CPU was in user mode
+	ushort pad;
+};
@@ -0,0 +1,238 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "fcntl.h"
+#include "pinfo.h"
+#include "prof.h"
+
+// usage: profile cmd args...
+//
+// Runs cmd with the sampling profiler on and prints a flat
+// profile of where the CPUs spent their timer ticks.  Kernel
+// samples are symbolized with kernel.sym, cmd's user samples
+// with cmd.sym (both are put on the file system by make).
+
+struct sym {
+	uint addr;
+	char *name;
+};
+
+struct symtab {
+	int n;
+	struct sym *s;
+};
+
+struct bucket {
+	char *name;
+	uint addr;    // for unsymbolized samples
+	int user;
+	int count;
+};
+
+struct profsample *samples;
+int nsamples, capsamples;
+
+struct bucket *buckets;
+int nbuckets, capbuckets;
+
+void *grow(void *old, int n, int cap, int size) {
+	void *p = malloc(cap * size);
+	if (p == 0) {
+		printf(2, "profile: out of memory\n");
+		exit();
+	}
+	if (old) {
+		memmove(p, old, n * size);
+		free(old);
+	}
+	return p;
+}
+
+void drain(void) {
+	for (;;) {
+		if (nsamples + NPROFSAMPLE > capsamples) {
+			samples = grow(samples, nsamples, capsamples * 2 + NPROFSAMPLE, sizeof(*samples));
+			capsamples = capsamples * 2 + NPROFSAMPLE;
+		}
+		int n = profread(samples + nsamples, NPROFSAMPLE);
+		nsamples += n;
+		if (n < NPROFSAMPLE)
+			return;
+	}
+}
+
+int exited(int pid) {
+	static struct pinfo pi[NPROC];
+	int n = get_pinfos(pi);
+	for (int i = 0; i < n; i++)
+		if (pi[i].pid == pid)
+			return pi[i].state[0] == 'z';
+	return 1;
+}
+
+int hexval(char c) {
+	if (c >= '0' && c <= '9')
+		return c - '0';
+	if (c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	return -1;
+}
+
+// Load a symbol table in the "addr name" format written by the
+// Makefile, sorted by address.  Leaves t empty if there is none.
+void loadsyms(char *path, struct symtab *t) {
+	struct stat st;
+	char *buf, *p, *e;
+	int fd, i, j;
+
+	t->n = 0;
+	if ((fd = open(path, O_RDONLY)) < 0)
+		return;
+	if (fstat(fd, &st) < 0 || (buf = malloc(st.size + 1)) == 0) {
+		close(fd);
+		return;
+	}
+	int n = read(fd, buf, st.size);
+	close(fd);
+	if (n < 0)
+		return;
+	buf[n] = 0;
+
+	int lines = 0;
+	for (p = buf; *p; p++)
+		if (*p == '\n')
+			lines++;
+	t->s = malloc((lines + 1) * sizeof(struct sym));
+
+	for (p = buf; *p; p = e + 1) {
+		if ((e = strchr(p, '\n')) == 0)
+			break;
+		*e = 0;
+		uint addr = 0;
+		while (hexval(*p) >= 0)
+			addr = addr * 16 + hexval(*p++);
+		if (*p != ' ' || addr == 0)
+			continue; // file names are at address 0
+		t->s[t->n].addr = addr;
+		t->s[t->n].name = p + 1;
+		t->n++;
+	}
+
+	// Insertion sort; the tables are a few hundred entries.
+	for (i = 1; i < t->n; i++) {
+		struct sym x = t->s[i];
+		for (j = i; j > 0 && t->s[j - 1].addr > x.addr; j--)
+			t->s[j] = t->s[j - 1];
+		t->s[j] = x;
+	}
+}
+
+// Name of the symbol containing addr, or 0.
+char *lookup(struct symtab *t, uint addr) {
+	int lo = 0, hi = t->n - 1, m;
+
+	if (t->n == 0 || addr < t->s[0].addr)
+		return 0;
+	while (lo < hi) {
+		m = (lo + hi + 1) / 2;
+		if (t->s[m].addr <= addr)
+			lo = m;
+		else
+			hi = m - 1;
+	}
+	return t->s[lo].name;
+}
+
+void count(char *name, uint addr, int user) {
+	for (int i = 0; i < nbuckets; i++)
+		if (buckets[i].user == user &&
+			(name ? buckets[i].name == name : buckets[i].addr == addr)) {
+			buckets[i].count++;
+			return;
+		}
+	if (nbuckets == capbuckets) {
+		buckets = grow(buckets, nbuckets, capbuckets * 2 + 64, sizeof(*buckets));
+		capbuckets = capbuckets * 2 + 64;
+	}
+	buckets[nbuckets].name = name;
+	buckets[nbuckets].addr = addr;
+	buckets[nbuckets].user = user;
+	buckets[nbuckets].count = 1;
+	nbuckets++;
+}
+
+int main(int argc, char **argv) {
+	static struct symtab ksyms, usyms;
+	char path[32];
+	int pid, dropped;
+
+	if (argc < 2) {
+		printf(2, "usage: profile cmd args...\n");
+		exit();
+	}
+
+	profctl(1);
+	pid = fork();
+	if (pid < 0) {
+		printf(2, "profile: fork failed\n");
+		exit();
+	}
+	if (pid == 0) {
+		exec(argv[1], argv + 1);
+		printf(2, "profile: exec %s failed\n", argv[1]);
+		exit();
+	}
+	while (!exited(pid)) {
+		sleep(5);
+		drain();
+	}
+	dropped = profctl(0);
+	drain();
+	wait();
+
+	loadsyms("kernel.sym", &ksyms);
+	// make cuts the name to 10 characters, to fit in DIRSIZ.
+	if (strlen(argv[1]) + 5 <= sizeof(path)) {
+		strcpy(path, argv[1]);
+		if (strlen(path) > 10)
+			path[10] = 0;
+		strcpy(path + strlen(path), ".sym");
+		loadsyms(path, &usyms);
+	}
+
+	for (int i = 0; i < nsamples; i++) {
+		struct profsample *s = &samples[i];
+		if (!s->user)
+			count(lookup(&ksyms, s->eip), s->eip, 0);
+		else if (s->pid == pid)
+			count(lookup(&usyms, s->eip), s->eip, 1);
+		else
+			count(0, 0, 2); // some other program's user code
+	}
+
+	// Hottest first.
+	for (int i = 0; i < nbuckets; i++)
+		for (int j = i + 1; j < nbuckets; j++)
+			if (buckets[j].count > buckets[i].count) {
+				struct bucket t = buckets[i];
+				buckets[i] = buckets[j];
+				buckets[j] = t;
+			}
+
+	printf(1, "\n%d samples, %d dropped\n", nsamples, dropped);
+	if (nsamples == 0)
+		exit();
+	printf(1, "samples\t%%\tmode\tfunction\n");
+	for (int i = 0; i < nbuckets; i++) {
+		struct bucket *b = &buckets[i];
+		printf(1, "%d\t%d\t%s\t", b->count, b->count * 100 / nsamples,
+			   b->user ? "user" : "kernel");
+		if (b->user == 2)
+			printf(1, "[other processes]\n");
+		else if (b->name)
+			printf(1, "%s\n", b->name);
+		else
+			printf(1, "0x%x\n", b->addr);
+	}
+	exit();
+}
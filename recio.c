@@ -0,0 +1,141 @@
+#include "types.h"
+#include "param.h"
+#include "user.h"
+#include "fcntl.h"
+#include "uio.h"
+#include "rusage.h"
+
+// usage: recio [nrec]
+//
+// Writes nrec (default 400) records, each a header and a
+// payload, to a file: with one write() per part, then with one
+// writev() per BATCH records.  Reads them back the same two
+// ways, and reads every 7th record with pread().  Each phase runs
+// in a child; prints the system calls (from wait4) and ticks it
+// took, and whether the records came back intact.
+
+#define FILE "recio.tmp"
+#define PAYLOAD 60
+#define BATCH (IOV_MAX / 2)
+
+struct rec {
+	int hdr;
+	char payload[PAYLOAD];
+};
+
+struct rec recs[BATCH];
+struct iovec iov[IOV_MAX];
+
+void fill(struct rec *r, int k) {
+	r->hdr = k;
+	memset(r->payload, k, PAYLOAD);
+}
+
+int bad(struct rec *r, int k) {
+	return r->hdr != k || r->payload[0] != (char)k || r->payload[PAYLOAD - 1] != (char)k;
+}
+
+// iov for n records in recs, as header and payload each.
+void setiov(int n) {
+	for (int i = 0; i < n; i++) {
+		iov[2 * i].iov_base = &recs[i].hdr;
+		iov[2 * i].iov_len = sizeof(recs[i].hdr);
+		iov[2 * i + 1].iov_base = recs[i].payload;
+		iov[2 * i + 1].iov_len = PAYLOAD;
+	}
+}
+
+int writeparts(int fd, int nrec) {
+	for (int k = 0; k < nrec; k++) {
+		fill(&recs[0], k);
+		if (write(fd, &recs[0].hdr, sizeof(recs[0].hdr)) < 0 ||
+			write(fd, recs[0].payload, PAYLOAD) < 0)
+			return 1;
+	}
+	return 0;
+}
+
+int writevec(int fd, int nrec) {
+	int k, i, n;
+
+	for (k = 0; k < nrec; k += n) {
+		n = nrec - k < BATCH ? nrec - k : BATCH;
+		for (i = 0; i < n; i++)
+			fill(&recs[i], k + i);
+		setiov(n);
+		if (writev(fd, iov, 2 * n) != n * sizeof(struct rec))
+			return 1;
+	}
+	return 0;
+}
+
+int readparts(int fd, int nrec) {
+	int errs = 0;
+
+	for (int k = 0; k < nrec; k++) {
+		if (read(fd, &recs[0].hdr, sizeof(recs[0].hdr)) != sizeof(recs[0].hdr) ||
+			read(fd, recs[0].payload, PAYLOAD) != PAYLOAD)
+			return 1;
+		errs += bad(&recs[0], k);
+	}
+	return errs != 0;
+}
+
+int readvec(int fd, int nrec) {
+	int k, i, n, errs = 0;
+
+	for (k = 0; k < nrec; k += n) {
+		n = nrec - k < BATCH ? nrec - k : BATCH;
+		setiov(n);
+		if (readv(fd, iov, 2 * n) != n * sizeof(struct rec))
+			return 1;
+		for (i = 0; i < n; i++)
+			errs += bad(&recs[i], k + i);
+	}
+	return errs != 0;
+}
+
+int readpos(int fd, int nrec) {
+	int errs = 0;
+
+	for (int k = 0; k < nrec; k += 7) {
+		if (pread(fd, &recs[0], sizeof(struct rec), k * sizeof(struct rec)) !=
+			sizeof(struct rec))
+			return 1;
+		errs += bad(&recs[0], k);
+	}
+	return errs != 0;
+}
+
+// Run fn on the file in a child and report.  The child's exit
+// code cannot carry the result, so a failure is printed there.
+void phase(char *name, int (*fn)(int, int), int mode, int nrec) {
+	struct rusage ru;
+	int pid, fd, t;
+
+	t = uptime();
+	if ((pid = fork()) == 0) {
+		if (mode & O_CREATE)
+			unlink(FILE);
+		if ((fd = open(FILE, mode)) < 0 || fn(fd, nrec))
+			printf(1, "recio: %s failed\n", name);
+		exit();
+	}
+	if (pid < 0 || wait4(pid, &ru) < 0) {
+		printf(2, "recio: fork failed\n");
+		exit();
+	}
+	printf(1, "%s\t%d syscalls\t%d ticks\n", name, ru.nsyscalls, uptime() - t);
+}
+
+int main(int argc, char **argv) {
+	int nrec = argc > 1 ? atoi(argv[1]) : 400;
+
+	phase("write", writeparts, O_CREATE | O_RDWR, nrec);
+	phase("read", readparts, O_RDONLY, nrec);
+	phase("writev", writevec, O_CREATE | O_RDWR, nrec);
+	phase("readv", readvec, O_RDONLY, nrec);
+	phase("pread", readpos, O_RDONLY, nrec);
+	unlink(FILE);
+	exit();
+}
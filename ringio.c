@@ -0,0 +1,142 @@
+#include "types.h"
+#include "param.h"
+#include "stat.h"
+#include "user.h"
+#include "fcntl.h"
+#include "rusage.h"
+#include "uring.h"
+
+// usage: ringio [kbytes]
+//
+// Writes a file of kbytes (default 64) and reads it back twice,
+// with one read() per 512-byte block and through a submission
+// ring: the open, up to URING_ENTRIES preads at a time, an fstat
+// and the close, each batch in one uring_enter().  Each phase runs
+// in a child; prints the system calls (from wait4) and ticks it
+// took, and whether the data came back intact.
+
+#define FILE "ringio.tmp"
+#define BLK 512
+
+char buf[URING_ENTRIES][BLK];
+
+int check(char *b, int k) {
+	return b[0] != (char)k || b[BLK - 1] != (char)(k * 3);
+}
+
+void fill(char *b, int k) {
+	memset(b, k, BLK);
+	b[BLK - 1] = k * 3;
+}
+
+int viaread(int nblk) {
+	int fd, k, errs = 0;
+
+	if ((fd = open(FILE, O_RDONLY)) < 0)
+		return 1;
+	for (k = 0; k < nblk; k++) {
+		if (read(fd, buf[0], BLK) != BLK)
+			return 1;
+		errs += check(buf[0], k);
+	}
+	close(fd);
+	return errs != 0;
+}
+
+struct uring *ring;
+
+// Queue one submission; the caller enters it.
+void submit(int op, int fd, void *addr, uint len, int off, uint data) {
+	struct uring_sqe *s = &ring->sq[ring->sq_tail % URING_ENTRIES];
+
+	s->op = op;
+	s->fd = fd;
+	s->addr = addr;
+	s->len = len;
+	s->off = off;
+	s->user_data = data;
+	ring->sq_tail++;
+}
+
+// Enter n submissions, wait for them all and return the result
+// of the last one to complete.  Results of reads go to res[]
+// by their user_data.
+int enter(int n, int *res) {
+	struct uring_cqe *c;
+	int r = -1;
+
+	if (uring_enter(n, n) != n)
+		return -1;
+	while (ring->cq_head != ring->cq_tail) {
+		c = &ring->cq[ring->cq_head % URING_ENTRIES];
+		r = c->res;
+		if (res)
+			res[c->user_data] = r;
+		ring->cq_head++;
+	}
+	return r;
+}
+
+int viaring(int nblk) {
+	static int res[URING_ENTRIES];
+	struct stat st;
+	int fd, k, i, n, errs = 0;
+
+	if ((ring = shmat(shmget(0, sizeof(*ring)))) == (void *)-1 || uring_setup(ring) < 0)
+		return 1;
+	submit(UR_OPEN, 0, FILE, O_RDONLY, 0, 0);
+	if ((fd = enter(1, 0)) < 0)
+		return 1;
+	for (k = 0; k < nblk; k += n) {
+		n = nblk - k < URING_ENTRIES ? nblk - k : URING_ENTRIES;
+		for (i = 0; i < n; i++)
+			submit(UR_READ, fd, buf[i], BLK, (k + i) * BLK, i);
+		enter(n, res);
+		for (i = 0; i < n; i++)
+			errs += res[i] != BLK || check(buf[i], k + i);
+	}
+	submit(UR_FSTAT, fd, &st, 0, -1, 0);
+	submit(UR_CLOSE, fd, 0, 0, -1, 1);
+	if (enter(2, res) < 0 || res[0] < 0 || st.size != nblk * BLK)
+		return 1;
+	return errs != 0;
+}
+
+// Run fn in a child and report.  The child's exit code cannot
+// carry the result, so a failure is printed there.
+void phase(char *name, int (*fn)(int), int nblk) {
+	struct rusage ru;
+	int pid, t;
+
+	t = uptime();
+	if ((pid = fork()) == 0) {
+		if (fn(nblk))
+			printf(1, "ringio: %s failed\n", name);
+		exit();
+	}
+	if (pid < 0 || wait4(pid, &ru) < 0) {
+		printf(2, "ringio: fork failed\n");
+		exit();
+	}
+	printf(1, "%s\t%d syscalls\t%d ticks\n", name, ru.nsyscalls, uptime() - t);
+}
+
+int main(int argc, char **argv) {
+	int nblk = (argc > 1 ? atoi(argv[1]) : 64) * 2, fd, k;
+
+	unlink(FILE);
+	if ((fd = open(FILE, O_CREATE | O_RDWR)) < 0) {
+		printf(2, "ringio: cannot create %s\n", FILE);
+		exit();
+	}
+	for (k = 0; k < nblk; k++) {
+		fill(buf[0], k);
+		write(fd, buf[0], BLK);
+	}
+	close(fd);
+
+	phase("read", viaread, nblk);
+	phase("ring", viaring, nblk);
+	unlink(FILE);
+	exit();
+}
@@ -0,0 +1,14 @@
+// Resource usage of a process, as returned by wait4.
+struct rusage {
+	uint rtime;       // ticks running
+	uint wtime;       // ticks runnable but not running
+	uint nvcsw;       // voluntary context switches (slept)
+	uint nivcsw;      // involuntary context switches (preempted)
+	uint nsyscalls;   // system calls
+	uint npgfaults;   // page faults
+	uint rbytes;      // bytes read by read()
+	uint wbytes;      // bytes written by write()
+	uint rblocks;     // disk blocks read in for it
+	uint wblocks;     // disk blocks written for it
+	uint rqwait[NRUHIST];  // RUNNABLE to RUNNING: time on the run queue (param.h)
+};
@@ -0,0 +1,924 @@
+// Scheduling policies.
+//
+// Every policy is a struct schedops; the one in use can be switched
+// at run time with schedctl(), and SCHEDULER (param.h, set by the
+// Makefile) only picks the one the kernel boots with.  Above the
+// policy sits the earliest-deadline-first real-time class of
+// sched_deadline(): its processes are queued on rtq instead, run
+// first, and preempt everything else.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "memlayout.h"
+#include "mmu.h"
+#include "x86.h"
+#include "proc.h"
+#include "spinlock.h"
+#include "sleeplock.h"
+#include "sched.h"
+#include "traps.h"
+#include "schedctl.h"
+#include "trace.h"
+
+static struct schedparam params = {
+  .policy = SCHEDULER,
+  .rr_slice = 1,
+  .starv_lim = STARV_LIM,
+  .quantum = { 1, 2, 4, 8, 16 },
+  .allot = { 1, 2, 4, 8, 16 },
+  .boost = MLFQ_BOOST,
+  .cfs_latency = CFS_LATENCY,
+  .cfs_mingran = CFS_MINGRAN,
+};
+
+// Runnable processes of the heap-based policies, in a binary
+// min-heap on rqkey: O(log n) to queue or pick, instead of the
+// ptable scans of the other policies.  ptable.lock protects them.
+struct runq {
+  struct proc *heap[NPROC];
+  int n;
+  uint load;      // sum of rqweight over the queued processes
+};
+
+static struct runq rtq;   // EDF, keyed by absolute deadline
+static struct runq rq;    // CFS or STRIDE
+
+static void
+rq_swap(struct runq *q, int i, int j)
+{
+  struct proc *t = q->heap[i];
+
+  q->heap[i] = q->heap[j];
+  q->heap[j] = t;
+  q->heap[i]->rqidx = i;
+  q->heap[j]->rqidx = j;
+}
+
+// Restore the heap order around slot i.
+static void
+rq_fix(struct runq *q, int i)
+{
+  int c;
+
+  for(; i > 0 && q->heap[i]->rqkey < q->heap[(i-1)/2]->rqkey; i = (i-1)/2)
+    rq_swap(q, i, (i-1)/2);
+  for(; (c = 2*i+1) < q->n; i = c){
+    if(c+1 < q->n && q->heap[c+1]->rqkey < q->heap[c]->rqkey)
+      c++;
+    if(q->heap[i]->rqkey <= q->heap[c]->rqkey)
+      break;
+    rq_swap(q, i, c);
+  }
+}
+
+static void
+rq_push(struct runq *q, struct proc *p, uint64 key, uint weight)
+{
+  if(p->rqidx >= 0)
+    return;
+  q->heap[q->n] = p;
+  p->rqidx = q->n++;
+  p->rqkey = key;
+  p->rqweight = weight;
+  q->load += weight;
+  rq_fix(q, p->rqidx);
+}
+
+static void
+rq_remove(struct runq *q, struct proc *p)
+{
+  int i = p->rqidx;
+
+  if(i < 0)
+    return;
+  rq_swap(q, i, --q->n);
+  if(i < q->n)
+    rq_fix(q, i);
+  p->rqidx = -1;
+  q->load -= p->rqweight;
+}
+
+static struct proc*
+rq_pop(struct runq *q)
+{
+  struct proc *p;
+
+  if(q->n == 0)
+    return 0;
+  p = q->heap[0];
+  rq_remove(q, p);
+  return p;
+}
+
+// Whether p may run on c.
+static int
+allowed(struct proc *p, struct cpu *c)
+{
+  return (p->cpumask >> (c - cpus)) & 1;
+}
+
+// Whether p last ran on c, so c's caches may still hold its data.
+static int
+warm(struct proc *p, struct cpu *c)
+{
+  return p->lastcpu == c - cpus;
+}
+
+// Take the first process in q that may run on c off it.  Those
+// skipped are put back afterwards; affinity is rare enough that
+// this is usually a single rq_pop.
+static struct proc*
+rq_pop_for(struct runq *q, struct cpu *c)
+{
+  struct proc *p, *skipped[NPROC];
+  int n = 0;
+
+  while((p = rq_pop(q)) != 0 && !allowed(p, c))
+    skipped[n++] = p;
+  while(n > 0){
+    struct proc *s = skipped[--n];
+    rq_push(q, s, s->rqkey, s->rqweight);
+  }
+  return p;
+}
+
+// Dequeue of the policies that queue on rq.
+static void
+rq_dequeue(struct proc *p)
+{
+  rq_remove(&rq, p);
+}
+
+// Tick handler of the policies that just run a process for
+// params.rr_slice ticks.
+static int
+slice_tick(struct proc *p)
+{
+  return ++p->curr_rtime >= params.rr_slice;
+}
+
+//PAGEBREAK!
+// Round robin: the next RUNNABLE process in ptable after the one
+// picked last.
+static struct proc*
+rr_pick(struct cpu *c)
+{
+  static int last;
+  struct proc *p;
+
+  for(int i = 1; i <= NPROC; i++){
+    p = &ptable.proc[(last + i) % NPROC];
+    if(p->state == RUNNABLE && !p->dl_runtime && allowed(p, c)){
+      last = p - ptable.proc;
+      return p;
+    }
+  }
+  return 0;
+}
+
+// First come first served: the oldest RUNNABLE process, which
+// runs until it gives up the CPU.  Of processes created on the same
+// tick, one that last ran here.
+static struct proc*
+fcfs_pick(struct cpu *c)
+{
+	uint min_ctime = 0;
+	struct proc *p = 0;
+
+	for (int i = 0; i < NPROC; i++) {
+		if (ptable.proc[i].state != RUNNABLE || ptable.proc[i].dl_runtime ||
+			!allowed(&ptable.proc[i], c))
+			continue;
+		if (ptable.proc[i].ctime < min_ctime || !p ||
+			(ptable.proc[i].ctime == min_ctime && warm(&ptable.proc[i], c) && !warm(p, c))) {
+			min_ctime = ptable.proc[i].ctime;
+			p = ptable.proc + i;
+		}
+	}
+	return p;
+}
+
+static int
+pbs_preempt(struct proc *p, struct proc *q)
+{
+  return p->priority < q->priority;
+}
+
+// Priority based: the RUNNABLE process with the lowest priority
+// number, the one that has run least often on ties, and then one
+// that last ran here.
+static struct proc*
+pbs_pick(struct cpu *c)
+{
+	uint high_pty = 101;
+	struct proc *p = 0;
+
+	for (int i = 0; i < NPROC; i++) {
+		if (ptable.proc[i].state != RUNNABLE || ptable.proc[i].dl_runtime ||
+			!allowed(&ptable.proc[i], c))
+			continue;
+		if (!p || ptable.proc[i].priority < high_pty ||
+			(ptable.proc[i].priority == high_pty && ptable.proc[i].rn_cnt < p->rn_cnt) ||
+			(ptable.proc[i].priority == high_pty && ptable.proc[i].rn_cnt == p->rn_cnt &&
+			 warm(&ptable.proc[i], c) && !warm(p, c))) {
+			high_pty = ptable.proc[i].priority;
+			p = ptable.proc + i;
+		}
+	}
+	return p;
+}
+
+//PAGEBREAK!
+// Multi-level feedback queue.  A process moves down a queue once it
+// has run allot[q] ticks in queue q, however many dispatches that
+// took, so giving up the CPU just before the quantum runs out does
+// not keep it up.  It moves up one queue after waiting starv_lim
+// ticks, and every boost ticks all processes go back to queue 0.
+struct queue {
+	int size;
+	struct proc *p[NPROC * 2];
+};
+
+static struct queue priorq[QCNT];
+
+static void pushq(int qid, struct proc *p) {
+	if (priorq[qid].size < 2 * NPROC) {
+#ifdef DEBUG
+  // cprintf("proc: %d added to q:%d\n", p->pid, qid);
+#endif
+		priorq[qid].p[priorq[qid].size++] = p;
+	}
+}
+
+static void remq(int qid, struct proc *p) {
+	for (int i = 0; i < priorq[qid].size; i++)
+		if (priorq[qid].p[i]->pid == p->pid) {
+#ifdef DEBUG
+			// cprintf("proc: %d removed to q:%d\n", p->pid, qid);
+#endif
+			for (int j = i + 1; j < priorq[qid].size; j++)
+				priorq[qid].p[j - 1] = priorq[qid].p[j];
+			priorq[qid].size--;
+      priorq[qid].p[priorq[qid].size]=0;
+			return;
+		}
+}
+
+static void age_procs(void) {
+	for (int i = 1; i < QCNT; i++) {
+		for (int j = 0; j < priorq[i].size; j++) {
+			if (priorq[i].p[j]->state == RUNNABLE &&
+				priorq[i].p[j]->curr_wtime > params.starv_lim) {
+				struct proc *p = priorq[i].p[j];
+				pushq(i - 1, p);
+				remq(i, p);
+				j--;
+				p->curr_q = i - 1;
+				p->curr_wtime = 0;
+				p->allot_used = 0;
+        #ifdef DEBUG
+          cprintf("proc: %s(%d) aged to q: %d\n", p->name, p->pid, p->curr_q);
+        #endif
+        schedtrace(TR_QUEUE, p, p->curr_q);
+			}
+		}
+	}
+}
+
+// Move every process to queue 0.
+static void boost_procs(void) {
+	for (struct proc *p = ptable.proc; p < &ptable.proc[NPROC]; p++) {
+		if (p->state == UNUSED || p->state == ZOMBIE || p->dl_runtime)
+			continue;
+		if (p->state == RUNNABLE)
+			remq(p->curr_q, p);
+		if (p->curr_q != 0)
+			schedtrace(TR_QUEUE, p, 0);
+		p->curr_q = 0;
+		p->allot_used = 0;
+		p->used_limit = 0;
+		if (p->state == RUNNABLE)
+			pushq(0, p);
+	}
+}
+
+static void
+mlfq_clock(void)
+{
+  static uint lastboost;
+
+  if(params.boost && ticks - lastboost >= params.boost){
+    lastboost = ticks;
+    boost_procs();
+  }
+  age_procs();
+}
+
+static int
+mlfq_preempt(struct proc *p, struct proc *q)
+{
+  return p->curr_q < q->curr_q;
+}
+
+static struct proc*
+mlfq_pick(struct cpu *c)
+{
+  struct proc *p;
+
+  // select the first process of the highest queue that may run
+  // on c; if not runnable rem from queue
+  // queue should only store runnable procs
+  for(int i=0; i<QCNT; i++){
+    for(int j=0; j<priorq[i].size; j++){
+      p = priorq[i].p[j];
+      if(p->state != RUNNABLE){
+        remq(i, p);
+        j--;
+      } else if(allowed(p, c)){
+        remq(i, p);
+        p->curr_wtime = 0;
+        return p;
+      }
+    }
+  }
+  return 0;
+}
+
+static void
+mlfq_enqueue(struct proc *p)
+{
+  pushq(p->curr_q, p);
+}
+
+static void
+mlfq_dequeue(struct proc *p)
+{
+  remq(p->curr_q, p);
+}
+
+static void
+mlfq_put_prev(struct proc *p)
+{
+  if(p->state != RUNNABLE)
+    return;
+  if(p->used_limit && p->curr_q < QCNT-1){
+    p->curr_q++;
+    p->curr_wtime=0;
+    p->allot_used=0;
+#ifdef DEBUG
+    cprintf("Proc: %s (%d) queue inc: %d\n",p->name, p->pid, p->curr_q);
+#endif
+    schedtrace(TR_QUEUE, p, p->curr_q);
+  }
+  p->used_limit = 0;
+  mlfq_enqueue(p);
+}
+
+static int
+mlfq_tick(struct proc *p)
+{
+  p->ticks_inq[p->curr_q]++;
+  if(++p->allot_used >= params.allot[p->curr_q]){
+    p->used_limit = 1;
+    return 1;
+  }
+  return ++p->curr_rtime >= params.quantum[p->curr_q];
+}
+
+//PAGEBREAK!
+// Completely fair: the process with the least virtual runtime,
+// its CPU time scaled by NICE0_WEIGHT/weight.
+
+// CFS weight of priorities 0..100, two priority points per Linux
+// nice level (this is Linux's prio_to_weight): each step is ~10%
+// of CPU, and the default priority 60 is nice 0.
+static const uint prio_to_weight[40] = {
+  88761, 71755, 56483, 46273, 36291,
+  29154, 23254, 18705, 14949, 11916,
+   9548,  7620,  6100,  4904,  3906,
+   3121,  2501,  1991,  1586,  1277,
+   1024,   820,   655,   526,   423,
+    335,   272,   215,   172,   137,
+    110,    87,    70,    56,    45,
+     36,    29,    23,    18,    15,
+};
+
+static uint64 min_vruntime;  // never decreases; floor for queued vruntimes
+
+static uint
+cfs_weight(struct proc *p)
+{
+  int i = (p->priority - 20) / 2;
+
+  if(i < 0)
+    i = 0;
+  if(i > 39)
+    i = 39;
+  return prio_to_weight[i];
+}
+
+static void
+cfs_enqueue(struct proc *p)
+{
+  rq_push(&rq, p, p->vruntime, cfs_weight(p));
+}
+
+// A new or waking process starts at min_vruntime so it cannot bank
+// the CPU time it did not use while asleep and then starve
+// everybody else.
+static void
+cfs_on_wakeup(struct proc *p)
+{
+  if(p->vruntime < min_vruntime)
+    p->vruntime = min_vruntime;
+}
+
+// Give p, about to run, its share, by weight, of a scheduling
+// period of cfs_latency ticks, stretched so that no runnable
+// process gets less than cfs_mingran.
+static struct proc*
+cfs_pick(struct cpu *c)
+{
+  struct proc *p;
+  uint w, period, slice;
+
+  if((p = rq_pop_for(&rq, c)) == 0)
+    return 0;
+  w = cfs_weight(p);
+  period = params.cfs_latency;
+  if((rq.n + 1) * params.cfs_mingran > period)
+    period = (rq.n + 1) * params.cfs_mingran;
+  slice = period * w / (rq.load + w);
+  p->slice = slice < params.cfs_mingran ? params.cfs_mingran : slice;
+  p->exec_start = rdtsc();
+  return p;
+}
+
+// Charge p for the time since it was dispatched and advance
+// min_vruntime.
+static void
+cfs_put_prev(struct proc *p)
+{
+  uint64 d, v;
+
+  d = (rdtsc() - p->exec_start) >> 10;
+  if(d > (1 << 20))   // keep d*NICE0_WEIGHT in 32 bits
+    d = 1 << 20;
+  p->vruntime += (uint)d * NICE0_WEIGHT / cfs_weight(p);
+
+  v = p->vruntime;
+  if(rq.n > 0 && rq.heap[0]->rqkey < v)
+    v = rq.heap[0]->rqkey;
+  if(v > min_vruntime)
+    min_vruntime = v;
+
+  if(p->state == RUNNABLE)
+    cfs_enqueue(p);
+}
+
+// q's vruntime is as of its dispatch, so this errs towards
+// letting it run.
+static int
+cfs_preempt(struct proc *p, struct proc *q)
+{
+  return p->vruntime < q->vruntime;
+}
+
+static int
+cfs_tick(struct proc *p)
+{
+  return ++p->curr_rtime >= p->slice;
+}
+
+//PAGEBREAK!
+// Stride: the process with the smallest pass, which then advances
+// by STRIDE1/tickets for the quantum it is about to get, so that
+// over time each process is dispatched in proportion to its
+// tickets.  Priority 0..100 buys 101..1 tickets.
+
+static uint64 global_pass;   // never decreases; floor for queued passes
+
+static uint
+stride_tickets(struct proc *p)
+{
+  return 101 - p->priority;
+}
+
+static void
+stride_enqueue(struct proc *p)
+{
+  rq_push(&rq, p, p->pass, stride_tickets(p));
+}
+
+// Like CFS, a process that was asleep or is new joins at
+// global_pass instead of cashing in the passes it missed.
+static void
+stride_on_wakeup(struct proc *p)
+{
+  if(p->pass < global_pass)
+    p->pass = global_pass;
+}
+
+static struct proc*
+stride_pick(struct cpu *c)
+{
+  struct proc *p;
+
+  if((p = rq_pop_for(&rq, c)) == 0)
+    return 0;
+  if(p->pass > global_pass)
+    global_pass = p->pass;
+  p->pass += STRIDE1 / stride_tickets(p);
+  return p;
+}
+
+static int
+stride_preempt(struct proc *p, struct proc *q)
+{
+  return p->pass < q->pass;
+}
+
+static void
+stride_put_prev(struct proc *p)
+{
+  if(p->state == RUNNABLE)
+    stride_enqueue(p);
+}
+
+static struct schedops policies[] = {
+[RR_SCHED]     { "rr", rr_pick, 0, 0, 0, slice_tick, 0, 0, 0 },
+[FCFS_SCHED]   { "fcfs", fcfs_pick, 0, 0, 0, 0, 0, 0, 0 },
+[PBS_SCHED]    { "pbs", pbs_pick, 0, 0, 0, slice_tick, 0, 0, pbs_preempt },
+[MLFQ_SCHED]   { "mlfq", mlfq_pick, mlfq_enqueue, mlfq_dequeue,
+                 mlfq_put_prev, mlfq_tick, 0, mlfq_clock, mlfq_preempt },
+[CFS_SCHED]    { "cfs", cfs_pick, cfs_enqueue, rq_dequeue,
+                 cfs_put_prev, cfs_tick, cfs_on_wakeup, 0, cfs_preempt },
+[STRIDE_SCHED] { "stride", stride_pick, stride_enqueue, rq_dequeue,
+                 stride_put_prev, slice_tick, stride_on_wakeup, 0,
+                 stride_preempt },
+};
+
+static struct schedops *policy = &policies[SCHEDULER];
+
+//PAGEBREAK!
+// Earliest-deadline-first real-time class.  rtq is ordered by the
+// absolute deadline of each process's current period.  A process
+// gets dl_runtime ticks per period; once they are used up it is
+// throttled until edf_clock starts its next period.
+
+// Start p's next period at tick now.
+static void
+edf_replenish(struct proc *p, uint now)
+{
+  p->dl_budget = p->dl_runtime;
+  p->dl_abs = now + p->dl_deadline;
+  p->dl_next = now + p->dl_period;
+  p->dl_throttled = 0;
+}
+
+// Queue p, which is RUNNABLE, with its class.
+static void
+enqueue(struct proc *p)
+{
+  if(p->dl_runtime){
+    if(!p->dl_throttled)
+      rq_push(&rtq, p, p->dl_abs, 0);
+  } else if(policy->enqueue)
+    policy->enqueue(p);
+}
+
+//PAGEBREAK!
+// Reschedule IPIs.  When a process becomes runnable, or its
+// priority changes, and it should run before a process that is
+// already running, the CPU running the least deserving one is
+// interrupted so that it picks again straight away, instead of at
+// its next timer tick (or, under FCFS, whenever its process
+// blocks).
+
+// Whether queued p should run before running q.
+static int
+beats(struct proc *p, struct proc *q)
+{
+  if(p->dl_runtime || q->dl_runtime)
+    return p->dl_runtime && (!q->dl_runtime || p->dl_abs < q->dl_abs);
+  return policy->preempt && policy->preempt(p, q);
+}
+
+static void
+resched(struct cpu *c)
+{
+  if(!c->need_resched){
+    c->need_resched = 1;
+    lapicipi(c->apicid, T_IRQ0 + IRQ_RESCHED);
+  }
+}
+
+// Preempt some CPU for p, which is queued, if it should be.
+static void
+kick(struct proc *p)
+{
+  struct cpu *c, *victim = 0;
+
+  for(c = cpus; c < cpus+ncpu; c++){
+    if(!allowed(p, c))
+      continue;
+    if(c->proc == 0)
+      return;   // an idle CPU will pick p up
+    if(beats(p, c->proc) && (victim == 0 || beats(victim->proc, c->proc)))
+      victim = c;
+  }
+  if(victim)
+    resched(victim);
+}
+
+// Start new real-time periods and count missed deadlines.
+static void
+edf_clock(void)
+{
+	for (struct proc *p = ptable.proc; p < &ptable.proc[NPROC]; p++) {
+		if (!p->dl_runtime || p->state == UNUSED || p->state == ZOMBIE)
+			continue;
+		// Still wanted CPU when the deadline came.
+		if (ticks == p->dl_abs && p->dl_budget > 0 &&
+			(p->state == RUNNABLE || p->state == RUNNING))
+			p->dl_misses++;
+		if ((int)(ticks - p->dl_next) >= 0) {
+			edf_replenish(p, ticks);
+			if (p->state == RUNNABLE) {
+				// Requeue under the new deadline.
+				rq_remove(&rtq, p);
+				enqueue(p);
+				kick(p);
+			}
+		}
+	}
+}
+
+//PAGEBREAK!
+// Interface to proc.c and trap.c.
+
+// Take the next process for c to run off its queue: the real-time
+// one with the earliest deadline, else the policy's choice.
+// Caller holds ptable.lock.
+struct proc*
+sched_pick(struct cpu *c)
+{
+  struct proc *p;
+
+  if((p = rq_pop_for(&rtq, c)) != 0)
+    return p;
+  return policy->pick_next(c);
+}
+
+// p is back in the scheduler after running.
+// Caller holds ptable.lock.
+void
+sched_put(struct proc *p)
+{
+  if(p->dl_runtime){
+    if(p->state == RUNNABLE)
+      enqueue(p);
+  } else if(policy->put_prev)
+    policy->put_prev(p);
+}
+
+// p has just been created or woken up and is RUNNABLE.
+// Caller holds ptable.lock.
+void
+sched_wakeup(struct proc *p)
+{
+  p->trunnable = rdtsc();
+  if(!p->dl_runtime && policy->on_wakeup)
+    policy->on_wakeup(p);
+  enqueue(p);
+  kick(p);
+}
+
+// p's priority has changed from old; requeue it under the new
+// one, and reschedule if that changes what should be running.
+// Caller holds ptable.lock.
+static void
+reprio(struct proc *p, uint old)
+{
+  struct cpu *c;
+
+  if(p->state == RUNNABLE){
+    if(!p->dl_runtime && policy->dequeue){
+      policy->dequeue(p);
+      policy->enqueue(p);
+    }
+    kick(p);
+  } else if(p->state == RUNNING && p->priority > old){
+    for(c = cpus; c < cpus+ncpu; c++)
+      if(c->proc == p)
+        resched(c);
+  }
+}
+
+// Priority inheritance.  A process waiting for a sleeplock lends
+// its priority to the owner, so a low-priority owner cannot be kept
+// off the CPU by medium-priority processes while a high-priority
+// one waits (priority inversion).  The effective priority is the
+// best of base_priority and the priorities of the processes waiting
+// for locks the process holds; it is recomputed whenever one of
+// those changes, and passed along to the owner of the lock the
+// process itself waits for.
+void
+sched_inherit(struct proc *p)
+{
+  struct proc *w;
+  uint pty, old;
+
+  acquire(&ptable.lock);
+  for(int depth = 0; p && depth < NPROC; depth++){
+    pty = p->base_priority;
+    for(w = ptable.proc; w < &ptable.proc[NPROC]; w++)
+      if(w->waitlock && w->waitlock->owner == p && w->priority < pty)
+        pty = w->priority;
+    if(pty == p->priority)
+      break;
+    old = p->priority;
+    p->priority = pty;
+    reprio(p, old);
+    p = p->waitlock ? p->waitlock->owner : 0;
+  }
+  release(&ptable.lock);
+}
+
+// Argument recorded with scheduler trace events: the MLFQ queue,
+// or the priority for the other policies.
+int
+sched_tracearg(struct proc *p)
+{
+  return policy == &policies[MLFQ_SCHED] ? p->curr_q : (int)p->priority;
+}
+
+// Whether a real-time process that may run on c is waiting, and
+// if so the earliest deadline among them in *key.
+static int
+rt_waiting(struct cpu *c, uint64 *key)
+{
+  int i, found = 0;
+
+  for(i = 0; i < rtq.n; i++)
+    if(allowed(rtq.heap[i], c) && (!found || rtq.heap[i]->rqkey < *key)){
+      *key = rtq.heap[i]->rqkey;
+      found = 1;
+    }
+  return found;
+}
+
+// Called on every timer tick on the CPU running myproc(): charge
+// the tick to its real-time budget or its policy, and say whether
+// it should give up the CPU.  A real-time process waiting that
+// may run here, with an earlier deadline (any deadline, if
+// myproc() is not real-time itself), preempts it.
+int
+sched_tick(void)
+{
+  struct proc *p = myproc();
+  uint64 key;
+  int r = 0;
+
+  acquire(&ptable.lock);
+  if(p->dl_runtime){
+    if(--p->dl_budget <= 0){
+      p->dl_throttled = 1;
+      r = 1;
+    } else if(rt_waiting(mycpu(), &key) && key < p->dl_abs)
+      r = 1;
+  } else {
+    if(policy->tick)
+      r = policy->tick(p);
+    if(rt_waiting(mycpu(), &key))
+      r = 1;
+  }
+  release(&ptable.lock);
+  return r;
+}
+
+// Called on every tick on CPU 0, like update_proctime.
+void
+sched_clock(void)
+{
+  acquire(&ptable.lock);
+  edf_clock();
+  if(policy->clock)
+    policy->clock();
+  release(&ptable.lock);
+}
+
+// Make the calling process real-time: runtime ticks of CPU in every
+// period, within deadline ticks of the period's start.  A runtime of
+// 0 returns it to the normal policy.  Fails if the real-time load
+// would exceed EDF_MAXUTIL per mille of every CPU.
+int sched_deadline(int runtime, int period, int deadline) {
+	struct proc *curproc = myproc();
+	uint util;
+
+	if (runtime == 0) {
+		acquire(&ptable.lock);
+		curproc->dl_runtime = 0;
+		release(&ptable.lock);
+		return 0;
+	}
+	if (runtime < 0 || runtime > deadline || deadline > period ||
+		period > EDF_MAXPERIOD)
+		return -1;
+
+	acquire(&ptable.lock);
+	util = runtime * 1000 / period;
+	for (struct proc *p = ptable.proc; p < &ptable.proc[NPROC]; p++)
+		if (p != curproc && p->dl_runtime && p->state != UNUSED && p->state != ZOMBIE)
+			util += p->dl_runtime * 1000 / p->dl_period;
+	if (util > EDF_MAXUTIL * ncpu) {
+		release(&ptable.lock);
+		return -1;
+	}
+	curproc->dl_runtime = runtime;
+	curproc->dl_period = period;
+	curproc->dl_deadline = deadline;
+	edf_replenish(curproc, ticks);
+	release(&ptable.lock);
+	return 0;
+}
+
+// Read (SCHEDCTL_GET) or change (SCHEDCTL_SET) the scheduling
+// policy and its tunables, in *sp, which must be kernel memory
+// that nobody else can change.  Switching policy moves every queued
+// process over to the new one; running processes follow when
+// they next come back to the scheduler.
+int schedctl(int op, struct schedparam *sp) {
+	struct proc *p;
+
+	if (op == SCHEDCTL_GET) {
+		acquire(&ptable.lock);
+		*sp = params;
+		release(&ptable.lock);
+		return 0;
+	}
+	if (op != SCHEDCTL_SET)
+		return -1;
+	if (sp->policy < 0 || sp->policy >= NELEM(policies) ||
+		sp->rr_slice < 1 || sp->starv_lim < 1 ||
+		sp->cfs_latency < 1 || sp->cfs_mingran < 1 || sp->boost < 0)
+		return -1;
+	for (int i = 0; i < QCNT; i++)
+		if (sp->quantum[i] < 1 || sp->allot[i] < 1)
+			return -1;
+
+	acquire(&ptable.lock);
+	if (&policies[sp->policy] != policy) {
+		for (p = ptable.proc; p < &ptable.proc[NPROC]; p++)
+			if (p->state == RUNNABLE && !p->dl_runtime && policy->dequeue)
+				policy->dequeue(p);
+		policy = &policies[sp->policy];
+		for (p = ptable.proc; p < &ptable.proc[NPROC]; p++)
+			if (p->state == RUNNABLE && !p->dl_runtime)
+				sched_wakeup(p);
+	}
+	params = *sp;
+	release(&ptable.lock);
+	return 0;
+}
+
+// Restrict process pid (0 for the caller) to the CPUs in mask.
+// If it is running on a CPU no longer in the mask, that CPU is
+// made to reschedule so the process moves.
+int sched_setaffinity(int pid, uint mask) {
+	struct proc *p;
+	struct cpu *c;
+
+	mask &= (1 << ncpu) - 1;
+	if (mask == 0)
+		return -1;
+	acquire(&ptable.lock);
+	for (p = ptable.proc; p < &ptable.proc[NPROC]; p++)
+		if (p->state != UNUSED && p->pid == (pid ? pid : myproc()->pid))
+			break;
+	if (p == &ptable.proc[NPROC]) {
+		release(&ptable.lock);
+		return -1;
+	}
+	p->cpumask = mask;
+	for (c = cpus; c < cpus + ncpu; c++)
+		if (c->proc == p && !allowed(p, c))
+			resched(c);
+	release(&ptable.lock);
+	return 0;
+}
+
+// The CPU mask of process pid (0 for the caller), or -1.
+int sched_getaffinity(int pid) {
+	int mask = -1;
+
+	acquire(&ptable.lock);
+	for (struct proc *p = ptable.proc; p < &ptable.proc[NPROC]; p++)
+		if (p->state != UNUSED && p->pid == (pid ? pid : myproc()->pid)) {
+			mask = p->cpumask & ((1 << ncpu) - 1);
+			break;
+		}
+	release(&ptable.lock);
+	return mask;
+}
@@ -0,0 +1,21 @@
+// Scheduling policy operations, one table per policy (see sched.c).
+// All are called with ptable.lock held.
+struct schedops {
+  char *name;
+  struct proc *(*pick_next)(struct cpu*);  // take the next process for c off the queue
+  void (*enqueue)(struct proc*);    // queue a RUNNABLE process
+  void (*dequeue)(struct proc*);    // take a queued process off the queue
+  void (*put_prev)(struct proc*);   // p is back from running; requeue if RUNNABLE
+  int (*tick)(struct proc*);        // timer tick while p runs; 1 to preempt it
+  void (*on_wakeup)(struct proc*);  // p is new or woke up, about to be queued
+  void (*clock)(void);              // once per tick, on CPU 0
+  int (*preempt)(struct proc*, struct proc*);  // should queued p run before running q?
+};
+
+// The process table, shared by proc.c and sched.c.
+struct ptable {
+  struct spinlock lock;
+  struct proc proc[NPROC];
+};
+
+extern struct ptable ptable;
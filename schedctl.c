@@ -0,0 +1,88 @@
+#include "types.h"
+#include "user.h"
+#include "param.h"
+#include "schedctl.h"
+
+// usage: schedctl [policy] [name=value ...]
+//
+// Prints the scheduling policy and its tunables, after switching
+// to policy (rr, fcfs, pbs, mlfq, cfs or stride) and setting the
+// given tunables, if any:
+//   slice=N          ticks per dispatch for rr, pbs and stride
+//   starv=N          mlfq: ticks waiting before moving up a queue
+//   q0=N ... q4=N    mlfq: ticks per dispatch in each queue
+//   a0=N ... a4=N    mlfq: ticks in each queue before moving down
+//   boost=N          mlfq: ticks between moving everything to queue 0
+//   latency=N        cfs: scheduling period
+//   mingran=N        cfs: shortest time slice
+
+char *names[] = {
+	[RR_SCHED] "rr",
+	[FCFS_SCHED] "fcfs",
+	[PBS_SCHED] "pbs",
+	[MLFQ_SCHED] "mlfq",
+	[CFS_SCHED] "cfs",
+	[STRIDE_SCHED] "stride",
+};
+
+#define NNAMES (sizeof(names) / sizeof(names[0]))
+
+// Split "name=value" in place; returns value, or 0 if there is no '='.
+char *value(char *arg) {
+	char *v = strchr(arg, '=');
+	if (v == 0)
+		return 0;
+	*v = 0;
+	return v + 1;
+}
+
+int main(int argc, char **argv) {
+	struct schedparam sp;
+	char *v;
+	int i, j;
+
+	if (schedctl(SCHEDCTL_GET, &sp) < 0) {
+		printf(2, "schedctl: cannot read scheduler parameters\n");
+		exit();
+	}
+	for (i = 1; i < argc; i++) {
+		if ((v = value(argv[i])) == 0) {
+			for (j = 0; j < NNAMES; j++)
+				if (strcmp(argv[i], names[j]) == 0)
+					break;
+			if (j == NNAMES)
+				goto usage;
+			sp.policy = j;
+		} else if (strcmp(argv[i], "slice") == 0)
+			sp.rr_slice = atoi(v);
+		else if (strcmp(argv[i], "starv") == 0)
+			sp.starv_lim = atoi(v);
+		else if (strcmp(argv[i], "boost") == 0)
+			sp.boost = atoi(v);
+		else if ((argv[i][0] == 'q' || argv[i][0] == 'a') && argv[i][1] >= '0' &&
+				 argv[i][1] < '0' + QCNT && argv[i][2] == 0)
+			(argv[i][0] == 'q' ? sp.quantum : sp.allot)[argv[i][1] - '0'] = atoi(v);
+		else if (strcmp(argv[i], "latency") == 0)
+			sp.cfs_latency = atoi(v);
+		else if (strcmp(argv[i], "mingran") == 0)
+			sp.cfs_mingran = atoi(v);
+		else
+			goto usage;
+	}
+	if (argc > 1 && schedctl(SCHEDCTL_SET, &sp) < 0) {
+		printf(2, "schedctl: parameters rejected\n");
+		exit();
+	}
+
+	printf(1, "policy %s\nslice=%d starv=%d", names[sp.policy], sp.rr_slice, sp.starv_lim);
+	for (i = 0; i < QCNT; i++)
+		printf(1, " q%d=%d", i, sp.quantum[i]);
+	for (i = 0; i < QCNT; i++)
+		printf(1, " a%d=%d", i, sp.allot[i]);
+	printf(1, " boost=%d latency=%d mingran=%d\n", sp.cfs_latency, sp.cfs_mingran);
+	exit();
+
+usage:
+	printf(2, "usage: schedctl [rr|fcfs|pbs|mlfq|cfs|stride] [name=value ...]\n");
+	exit();
+}
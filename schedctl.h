@@ -0,0 +1,18 @@
+#define QCNT 5
+
+#define SCHEDCTL_GET 0
+#define SCHEDCTL_SET 1
+
+// Scheduling policy and its tunables, for schedctl().  The policy
+// is one of RR_SCHED ... STRIDE_SCHED from param.h; times are in
+// ticks.
+struct schedparam {
+	int policy;
+	int rr_slice;       // ticks per dispatch for RR, PBS and STRIDE
+	int starv_lim;      // MLFQ: ticks waiting before moving up a queue
+	int quantum[QCNT];  // MLFQ: ticks per dispatch in each queue
+	int allot[QCNT];    // MLFQ: ticks in each queue, over all dispatches, before moving down
+	int boost;          // MLFQ: ticks between moving everything to queue 0, 0 for never
+	int cfs_latency;    // CFS: period every runnable process runs in
+	int cfs_mingran;    // CFS: shortest time slice
+};
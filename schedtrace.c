@@ -0,0 +1,77 @@
+#include "types.h"
+#include "user.h"
+#include "fcntl.h"
+#include "pinfo.h"
+#include "trace.h"
+
+// usage: schedtrace [-o file] cmd args...
+//
+// Runs cmd with scheduler tracing on and writes the binary
+// struct schedevent records to file (default "trace") for
+// plot_graph.py.
+
+struct schedevent buf[NTRACE];
+
+int exited(int pid) {
+	static struct pinfo pi[NPROC];
+	int n = get_pinfos(pi);
+	for (int i = 0; i < n; i++)
+		if (pi[i].pid == pid)
+			return pi[i].state[0] == 'z';
+	return 1;
+}
+
+int drain(int fd) {
+	int n, total = 0;
+	while ((n = traceread(buf, NTRACE)) > 0) {
+		if (write(fd, buf, n * sizeof(buf[0])) != n * sizeof(buf[0])) {
+			printf(2, "schedtrace: write failed\n");
+			exit();
+		}
+		total += n;
+	}
+	return total;
+}
+
+int main(int argc, char **argv) {
+	char *out = "trace";
+	int fd, pid, n = 0, dropped;
+
+	argv++, argc--;
+	if (argc >= 2 && strcmp(argv[0], "-o") == 0) {
+		out = argv[1];
+		argv += 2, argc -= 2;
+	}
+	if (argc < 1) {
+		printf(2, "usage: schedtrace [-o file] cmd args...\n");
+		exit();
+	}
+	unlink(out); // there is no O_TRUNC
+	if ((fd = open(out, O_CREATE | O_WRONLY)) < 0) {
+		printf(2, "schedtrace: cannot open %s\n", out);
+		exit();
+	}
+
+	tracectl(1);
+	pid = fork();
+	if (pid < 0) {
+		printf(2, "schedtrace: fork failed\n");
+		exit();
+	}
+	if (pid == 0) {
+		close(fd);
+		exec(argv[0], argv);
+		printf(2, "schedtrace: exec %s failed\n", argv[0]);
+		exit();
+	}
+	while (!exited(pid)) {
+		sleep(5);
+		n += drain(fd);
+	}
+	dropped = tracectl(0);
+	n += drain(fd);
+	wait();
+	close(fd);
+	printf(1, "schedtrace: %d events written to %s, %d dropped\n", n, out, dropped);
+	exit();
+}
@@ -1,8 +1,11 @@
 // Shell.
 
 #include "types.h"
+#include "param.h"
 #include "user.h"
+#include "rusage.h"
 #include "fcntl.h"
+#include "spawn.h"
 
 // Parsed command representation
 #define EXEC  1
@@ -52,6 +55,7 @@ struct backcmd {
 int fork1(void);  // Fork but panics on failure.
 void panic(char*);
 struct cmd *parsecmd(char*);
+void freecmd(struct cmd*);
 
 // Execute cmd.  Never returns.
 void
@@ -130,6 +134,112 @@ runcmd(struct cmd *cmd)
   exit();
 }
 
+// Can cmd be started with spawn(), with nact file actions
+// already queued?  Pipelines have all their processes started by
+// the shell.  A list is run one command after the other, which
+// only works at the top level (nact == 0): in a pipeline its
+// commands must run together, and behind a redirection they must
+// share one open file.  Those, and blocks and &, need a forked
+// shell.
+int
+spawnable(struct cmd *cmd, int nact)
+{
+  struct listcmd *lcmd;
+  struct pipecmd *pcmd;
+
+  if(cmd == 0 || nact > SPAWN_MAXACT)
+    return 0;
+  switch(cmd->type){
+  case EXEC:
+    return ((struct execcmd*)cmd)->argv[0] != 0;
+  case REDIR:
+    return spawnable(((struct redircmd*)cmd)->cmd, nact+1);
+  case PIPE:
+    pcmd = (struct pipecmd*)cmd;
+    return spawnable(pcmd->left, nact+3) && spawnable(pcmd->right, nact+3);
+  case LIST:
+    lcmd = (struct listcmd*)cmd;
+    return nact == 0 && spawnable(lcmd->left, 0) && spawnable(lcmd->right, 0);
+  }
+  return 0;
+}
+
+// Wait for the n children in pids.
+void
+waitpids(int *pids, int n)
+{
+  static struct rusage ru;
+
+  while(n > 0)
+    wait4(pids[--n], &ru);
+}
+
+// Start cmd, which spawnable() accepted, with the nact file
+// actions in act done first, without forking the shell.  Adds
+// the pids of the children left to wait for to pids and returns
+// how many there are.
+int
+launch(struct cmd *cmd, struct spawnact *act, int nact, int *pids)
+{
+  int p[2], n;
+  struct execcmd *ecmd;
+  struct listcmd *lcmd;
+  struct pipecmd *pcmd;
+  struct redircmd *rcmd;
+
+  switch(cmd->type){
+  case EXEC:
+    ecmd = (struct execcmd*)cmd;
+    if((n = spawn(ecmd->argv[0], ecmd->argv, act, nact)) >= 0){
+      pids[0] = n;
+      return 1;
+    }
+    if(n <= -2 && act[-2-n].op == SPAWN_OPEN)
+      printf(2, "open %s failed\n", act[-2-n].path);
+    else
+      printf(2, "exec %s failed\n", ecmd->argv[0]);
+    return 0;
+
+  case REDIR:
+    rcmd = (struct redircmd*)cmd;
+    memset(&act[nact], 0, sizeof(act[nact]));
+    act[nact].op = SPAWN_OPEN;
+    act[nact].fd = rcmd->fd;
+    act[nact].path = rcmd->file;
+    act[nact].mode = rcmd->mode;
+    return launch(rcmd->cmd, act, nact+1, pids);
+
+  case LIST:
+    lcmd = (struct listcmd*)cmd;
+    waitpids(pids, launch(lcmd->left, act, nact, pids));
+    return launch(lcmd->right, act, nact, pids);
+
+  case PIPE:
+    pcmd = (struct pipecmd*)cmd;
+    if(pipe(p) < 0){
+      printf(2, "pipe failed\n");
+      return 0;
+    }
+    memset(&act[nact], 0, 3*sizeof(act[nact]));
+    act[nact].op = SPAWN_DUP2;
+    act[nact].fd = p[1];
+    act[nact].newfd = 1;
+    act[nact+1].op = SPAWN_CLOSE;
+    act[nact+1].fd = p[0];
+    act[nact+2].op = SPAWN_CLOSE;
+    act[nact+2].fd = p[1];
+    n = launch(pcmd->left, act, nact+3, pids);
+    act[nact].fd = p[0];
+    act[nact].newfd = 0;
+    n += launch(pcmd->right, act, nact+3, pids+n);
+    close(p[0]);
+    close(p[1]);
+    return n;
+  }
+  panic("launch");
+  return 0;
+}
+
 int
 getcmd(char *buf, int nbuf)
 {
@@ -145,6 +255,9 @@ int
 main(void)
 {
   static char buf[100];
+  static struct spawnact act[SPAWN_MAXACT];
+  static int pids[SPAWN_MAXACT];
+  struct cmd *cmd;
   int fd;
 
   // Ensure that three file descriptors are open.
@@ -164,9 +277,18 @@ main(void)
         printf(2, "cannot cd %s\n", buf+3);
       continue;
     }
-    if(fork1() == 0)
-      runcmd(parsecmd(buf));
-    wait();
+    if((cmd = parsecmd(buf)) == 0)
+      continue;
+    // Plain commands and pipelines are spawned, without a copy
+    // of the shell; the rest run in a forked shell.
+    if(spawnable(cmd, 0)){
+      waitpids(pids, launch(cmd, act, 0, pids));
+    } else {
+      if(fork1() == 0)
+        runcmd(cmd);
+      wait();
+    }
+    freecmd(cmd);
   }
   exit();
 }
@@ -319,6 +441,18 @@ peek(char **ps, char *es, char *toks)
   return *s && strchr(toks, *s);
 }
 
+// Parse errors are reported with syntax() and make parsecmd()
+// return 0, as the shell itself parses.
+int syntaxerr;
+
+void
+syntax(char *msg)
+{
+  if(!syntaxerr)
+    printf(2, "%s\n", msg);
+  syntaxerr = 1;
+}
+
 struct cmd *parseline(char**, char*);
 struct cmd *parsepipe(char**, char*);
 struct cmd *parseexec(char**, char*);
@@ -330,12 +464,17 @@ parsecmd(char *s)
   char *es;
   struct cmd *cmd;
 
+  syntaxerr = 0;
   es = s + strlen(s);
   cmd = parseline(&s, es);
   peek(&s, es, "");
-  if(s != es){
+  if(s != es && !syntaxerr){
     printf(2, "leftovers: %s\n", s);
-    panic("syntax");
+    syntax("syntax");
+  }
+  if(syntaxerr){
+    freecmd(cmd);
+    return 0;
   }
   nulterminate(cmd);
   return cmd;
@@ -379,8 +518,10 @@ parseredirs(struct cmd *cmd, char **ps, char *es)
 
   while(peek(ps, es, "<>")){
     tok = gettoken(ps, es, 0, 0);
-    if(gettoken(ps, es, &q, &eq) != 'a')
-      panic("missing file for redirection");
+    if(gettoken(ps, es, &q, &eq) != 'a'){
+      syntax("missing file for redirection");
+      break;
+    }
     switch(tok){
     case '<':
       cmd = redircmd(cmd, q, eq, O_RDONLY, 0);
@@ -405,8 +546,10 @@ parseblock(char **ps, char *es)
     panic("parseblock");
   gettoken(ps, es, 0, 0);
   cmd = parseline(ps, es);
-  if(!peek(ps, es, ")"))
-    panic("syntax - missing )");
+  if(!peek(ps, es, ")")){
+    syntax("syntax - missing )");
+    return cmd;
+  }
   gettoken(ps, es, 0, 0);
   cmd = parseredirs(cmd, ps, es);
   return cmd;
@@ -428,16 +571,20 @@ parseexec(char **ps, char *es)
 
   argc = 0;
   ret = parseredirs(ret, ps, es);
-  while(!peek(ps, es, "|)&;")){
+  while(!peek(ps, es, "|)&;") && !syntaxerr){
     if((tok=gettoken(ps, es, &q, &eq)) == 0)
       break;
-    if(tok != 'a')
-      panic("syntax");
+    if(tok != 'a'){
+      syntax("syntax");
+      break;
+    }
+    if(argc+1 >= MAXARGS){
+      syntax("too many args");
+      break;
+    }
     cmd->argv[argc] = q;
     cmd->eargv[argc] = eq;
     argc++;
-    if(argc >= MAXARGS)
-      panic("too many args");
     ret = parseredirs(ret, ps, es);
   }
   cmd->argv[argc] = 0;
@@ -491,3 +638,32 @@ nulterminate(struct cmd *cmd)
   }
   return cmd;
 }
+
+// Free what parsecmd() allocated.
+void
+freecmd(struct cmd *cmd)
+{
+  if(cmd == 0)
+    return;
+
+  switch(cmd->type){
+  case REDIR:
+    freecmd(((struct redircmd*)cmd)->cmd);
+    break;
+
+  case PIPE:
+    freecmd(((struct pipecmd*)cmd)->left);
+    freecmd(((struct pipecmd*)cmd)->right);
+    break;
+
+  case LIST:
+    freecmd(((struct listcmd*)cmd)->left);
+    freecmd(((struct listcmd*)cmd)->right);
+    break;
+
+  case BACK:
+    freecmd(((struct backcmd*)cmd)->cmd);
+    break;
+  }
+  free(cmd);
+}
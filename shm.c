@@ -0,0 +1,270 @@
+// Shared memory segments.
+//
+// shmget() creates a segment of kalloc'd pages and shmat() maps
+// them into one of NSHMAT fixed slots above the heap, at
+// SHMBASE + slot*SHMPAGES*PGSIZE.  Attachments belong to a page
+// table, so the threads on it share them, and fork() copies
+// them.  The PTEs carry PTE_SHARED, so freevm() does not free the
+// pages; instead it drops the page table's attachments through
+// shmfree().  A segment's pages are freed with its last
+// attachment.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "memlayout.h"
+#include "mmu.h"
+#include "proc.h"
+#include "spinlock.h"
+
+struct shmseg {
+  int key;          // 0 for a private segment
+  int npages;       // 0 if the segment is free
+  int nattach;      // page tables it is attached to
+  char *pages[SHMPAGES];
+};
+
+struct shmattach {
+  pde_t *pgdir;     // 0 if the entry is free
+  int seg;
+  int slot;
+  int detaching;    // shmdt() is unmapping it; the slot stays taken
+};
+
+static struct {
+  struct spinlock lock;
+  struct shmseg seg[NSHM];
+  struct shmattach at[NPROC*NSHMAT];
+} shm;
+
+void
+shminit(void)
+{
+  initlock(&shm.lock, "shm");
+}
+
+static uint
+slotva(int slot)
+{
+  return SHMBASE + slot*SHMPAGES*PGSIZE;
+}
+
+// Free the pages of segment s.  Caller holds shm.lock.
+static void
+segfree(struct shmseg *s)
+{
+  int i;
+
+  for(i = 0; i < s->npages; i++)
+    kfree(s->pages[i]);
+  s->npages = 0;
+  s->key = 0;
+}
+
+// Drop attachment a.  Caller holds shm.lock.
+static void
+atput(struct shmattach *a)
+{
+  struct shmseg *s = &shm.seg[a->seg];
+
+  if(--s->nattach == 0)
+    segfree(s);
+  a->pgdir = 0;
+}
+
+// Find a free attachment entry.  Caller holds shm.lock.
+static struct shmattach*
+atalloc(void)
+{
+  struct shmattach *a;
+
+  for(a = shm.at; a < &shm.at[NELEM(shm.at)]; a++)
+    if(a->pgdir == 0)
+      return a;
+  return 0;
+}
+
+// Return the id of the segment with key, creating one of at
+// least size bytes if there is none.  Key 0 always creates a
+// new private segment.  Returns -1 if size does not fit.
+int
+shmget(int key, uint size)
+{
+  struct shmseg *s, *free;
+  int i, npages;
+
+  npages = PGROUNDUP(size) / PGSIZE;
+  if(npages == 0 || npages > SHMPAGES)
+    return -1;
+
+  acquire(&shm.lock);
+  free = 0;
+  for(s = shm.seg; s < &shm.seg[NSHM]; s++){
+    if(s->npages == 0){
+      if(free == 0)
+        free = s;
+    } else if(key != 0 && s->key == key){
+      release(&shm.lock);
+      return npages <= s->npages ? s - shm.seg : -1;
+    }
+  }
+  if((s = free) == 0){
+    release(&shm.lock);
+    return -1;
+  }
+  for(i = 0; i < npages; i++){
+    if((s->pages[i] = kalloc()) == 0){
+      s->npages = i;
+      segfree(s);
+      release(&shm.lock);
+      return -1;
+    }
+    memset(s->pages[i], 0, PGSIZE);
+  }
+  s->key = key;
+  s->npages = npages;
+  s->nattach = 0;
+  release(&shm.lock);
+  return s - shm.seg;
+}
+
+// Attach segment id to the current process.
+// Returns the address it is mapped at, or -1.
+int
+shmat(int id)
+{
+  pde_t *pgdir = myproc()->pgdir;
+  struct shmattach *a;
+  struct shmseg *s;
+  uint used = 0;
+  int slot;
+
+  if(id < 0 || id >= NSHM)
+    return -1;
+  acquire(&shm.lock);
+  s = &shm.seg[id];
+  for(a = shm.at; a < &shm.at[NELEM(shm.at)]; a++)
+    if(a->pgdir == pgdir)
+      used |= 1 << a->slot;
+  for(slot = 0; slot < NSHMAT && (used & (1 << slot)); slot++)
+    ;
+  if(s->npages == 0 || slot == NSHMAT || (a = atalloc()) == 0){
+    release(&shm.lock);
+    return -1;
+  }
+  if(shmmap(pgdir, slotva(slot), s->pages, s->npages) < 0){
+    shmunmap(pgdir, slotva(slot), s->npages);
+    release(&shm.lock);
+    return -1;
+  }
+  a->pgdir = pgdir;
+  a->seg = id;
+  a->slot = slot;
+  a->detaching = 0;
+  s->nattach++;
+  release(&shm.lock);
+  return slotva(slot);
+}
+
+// Detach the segment attached at va from the current process.
+// Fails if a system call of another thread has some of it
+// pinned.  checkptr() takes shm.lock after pinning, and sees
+// the attachment detaching from the check on.
+int
+shmdt(uint va)
+{
+  pde_t *pgdir = myproc()->pgdir;
+  struct shmattach *a;
+  int npages;
+
+  acquire(&shm.lock);
+  for(a = shm.at; a < &shm.at[NELEM(shm.at)]; a++)
+    if(a->pgdir == pgdir && !a->detaching && slotva(a->slot) == va)
+      break;
+  if(a == &shm.at[NELEM(shm.at)]){
+    release(&shm.lock);
+    return -1;
+  }
+  npages = shm.seg[a->seg].npages;
+  if(uvmpinned(pgdir, va, va + npages*PGSIZE)){
+    release(&shm.lock);
+    return -1;
+  }
+  a->detaching = 1;
+  release(&shm.lock);
+
+  // Other threads may have the pages in their TLBs; they must
+  // be gone from there before the pages can be freed.
+  shmunmap(pgdir, va, npages);
+  tlbshootdown(pgdir);
+
+  acquire(&shm.lock);
+  atput(a);
+  release(&shm.lock);
+  return 0;
+}
+
+// Give page table to the same attachments as from (for fork).
+// On failure, freevm(to) cleans up what was done.
+int
+shmfork(pde_t *from, pde_t *to)
+{
+  struct shmattach *a, *b;
+  struct shmseg *s;
+
+  acquire(&shm.lock);
+  for(a = shm.at; a < &shm.at[NELEM(shm.at)]; a++){
+    if(a->pgdir != from || a->detaching)
+      continue;
+    s = &shm.seg[a->seg];
+    if((b = atalloc()) == 0){
+      release(&shm.lock);
+      return -1;
+    }
+    if(shmmap(to, slotva(a->slot), s->pages, s->npages) < 0){
+      shmunmap(to, slotva(a->slot), s->npages);
+      release(&shm.lock);
+      return -1;
+    }
+    *b = *a;
+    b->pgdir = to;
+    s->nattach++;
+  }
+  release(&shm.lock);
+  return 0;
+}
+
+// Drop every attachment of pgdir, which is being freed.
+void
+shmfree(pde_t *pgdir)
+{
+  struct shmattach *a;
+
+  acquire(&shm.lock);
+  for(a = shm.at; a < &shm.at[NELEM(shm.at)]; a++)
+    if(a->pgdir == pgdir)
+      atput(a);
+  release(&shm.lock);
+}
+
+// End of the segment attached to pgdir that contains va,
+// or 0 if there is none.
+uint
+shmend(pde_t *pgdir, uint va)
+{
+  struct shmattach *a;
+  uint start, end = 0;
+
+  acquire(&shm.lock);
+  for(a = shm.at; a < &shm.at[NELEM(shm.at)]; a++){
+    if(a->pgdir != pgdir || a->detaching)
+      continue;
+    start = slotva(a->slot);
+    if(va >= start && va < start + shm.seg[a->seg].npages*PGSIZE){
+      end = start + shm.seg[a->seg].npages*PGSIZE;
+      break;
+    }
+  }
+  release(&shm.lock);
+  return end;
+}
@@ -0,0 +1,91 @@
+#include "types.h"
+#include "user.h"
+
+// usage: shmpipe [kbytes]
+//
+// A child sends kbytes (default 4096) to its parent, first through
+// a pipe and then through a ring of blocks in a shared memory
+// segment guarded by two semaphores, which the parent reads in
+// place.  Prints how many ticks each took.
+
+#define BLK 4096
+#define NBLK 8
+
+struct ring {
+	struct sem full;   // blocks written and not yet read
+	struct sem empty;  // blocks free for writing
+	char buf[NBLK][BLK];
+};
+
+char buf[BLK];
+
+int check(char *b, int i) {
+	return b[0] == (char)i && b[BLK - 1] == (char)i;
+}
+
+int viapipe(int n) {
+	int fd[2], i, got, r, bad = 0;
+
+	if (pipe(fd) < 0)
+		return -1;
+	if (fork() == 0) {
+		close(fd[0]);
+		for (i = 0; i < n; i++) {
+			memset(buf, i, BLK);
+			write(fd[1], buf, BLK);
+		}
+		exit();
+	}
+	close(fd[1]);
+	for (i = 0; i < n; i++) {
+		for (got = 0; got < BLK; got += r)
+			if ((r = read(fd[0], buf + got, BLK - got)) <= 0)
+				return -1;
+		bad += !check(buf, i);
+	}
+	close(fd[0]);
+	wait();
+	return bad;
+}
+
+int viashm(int n) {
+	struct ring *r;
+	int id, i, bad = 0;
+
+	if ((id = shmget(0, sizeof(*r))) < 0 || (r = shmat(id)) == (void *)-1)
+		return -1;
+	sem_init(&r->full, 0);
+	sem_init(&r->empty, NBLK);
+	if (fork() == 0) {
+		for (i = 0; i < n; i++) {
+			sem_wait(&r->empty);
+			memset(r->buf[i % NBLK], i, BLK);
+			sem_post(&r->full);
+		}
+		exit();
+	}
+	for (i = 0; i < n; i++) {
+		sem_wait(&r->full);
+		bad += !check(r->buf[i % NBLK], i);
+		sem_post(&r->empty);
+	}
+	wait();
+	shmdt(r);
+	return bad;
+}
+
+int main(int argc, char **argv) {
+	int n = 4096 * 1024 / BLK, t, bad;
+
+	if (argc > 1)
+		n = atoi(argv[1]) * 1024 / BLK;
+
+	t = uptime();
+	bad = viapipe(n);
+	printf(1, "pipe: %d blocks in %d ticks, %d bad\n", n, uptime() - t, bad);
+
+	t = uptime();
+	bad = viashm(n);
+	printf(1, "shm:  %d blocks in %d ticks, %d bad\n", n, uptime() - t, bad);
+	exit();
+}
@@ -1,4 +1,16 @@
 // Sleeping locks
+//
+// Sleeplocks are adaptive: a process that finds the lock held
+// by a process running on another CPU spins for a while, since
+// the owner is probably about to release it (typical for short
+// buffer and inode critical sections).  It only goes to sleep,
+// paying for a trip through the scheduler, if the owner is not
+// running or does not release the lock within SPINCYCLES.
+//
+// A process sleeping for a sleeplock lends its priority to the
+// owner until releasesleep() (see sched_inherit), so a high-
+// priority process is not blocked for long behind a low-priority
+// owner that medium-priority processes keep off the CPU.
 
 #include "types.h"
 #include "defs.h"
@@ -10,34 +22,94 @@
 #include "spinlock.h"
 #include "sleeplock.h"
 
+#define SPINCYCLES 100000  // longest spin on a running owner
+
 void
 initsleeplock(struct sleeplock *lk, char *name)
 {
   initlock(&lk->lk, "sleep lock");
   lk->name = name;
   lk->locked = 0;
+  lk->owner = 0;
+  lk->nwaiters = 0;
   lk->pid = 0;
+  lk->cls = lockclass(name, 1);
+}
+
+// Spin while lk is still held by owner and owner is running.
+// Called without lk->lk held; the reads are racy, but they only
+// decide whether to keep spinning, and acquiresleep() rechecks
+// everything under lk->lk afterwards.
+static void
+spinowner(struct sleeplock *lk, struct proc *owner)
+{
+  uint64 end;
+
+  end = rdtsc() + SPINCYCLES;
+  while(*(volatile uint*)&lk->locked &&
+        *(struct proc* volatile*)&lk->owner == owner &&
+        *(volatile enum procstate*)&owner->state == RUNNING &&
+        rdtsc() < end)
+    pause();
 }
 
 void
 acquiresleep(struct sleeplock *lk)
 {
+  struct proc *p = myproc();
+  struct proc *owner;
+  uint64 t0;
+  int contended, spun;
+
   acquire(&lk->lk);
+  contended = lk->locked;
+  t0 = contended ? rdtsc() : 0;
+  spun = 0;
   while (lk->locked) {
+    owner = lk->owner;
+    if (!spun && owner && owner != p && owner->state == RUNNING) {
+      spun = 1;
+      release(&lk->lk);
+      spinowner(lk, owner);
+      acquire(&lk->lk);
+      continue;
+    }
+    lk->nwaiters++;
+    p->waitlock = lk;
+    sched_inherit(owner);
     sleep(lk, &lk->lk);
+    p->waitlock = 0;
+    lk->nwaiters--;
+    spun = 0;
   }
   lk->locked = 1;
-  lk->pid = myproc()->pid;
+  lk->owner = p;
+  lk->pid = p->pid;
+  lk->tacquire = rdtsc();
+  lockstat_acquire(lk->cls, contended, contended ? lk->tacquire - t0 : 0);
+  if(lk->nwaiters)
+    sched_inherit(p);   // inherit from the remaining waiters
   release(&lk->lk);
 }
 
 void
 releasesleep(struct sleeplock *lk)
 {
+  struct proc *owner;
+
   acquire(&lk->lk);
+  lockstat_release(lk->cls, rdtsc() - lk->tacquire);
+  owner = lk->owner;
   lk->locked = 0;
+  lk->owner = 0;
   lk->pid = 0;
-  wakeup(lk);
+  // Give back what the waiters lent.
+  if(owner->priority != owner->base_priority)
+    sched_inherit(owner);
+  // Spinning waiters see locked drop without help;
+  // only sleeping ones need the trip through ptable.
+  if(lk->nwaiters)
+    wakeup(lk);
   release(&lk->lk);
 }
 
@@ -47,7 +119,7 @@ holdingsleep(struct sleeplock *lk)
   int r;
   
   acquire(&lk->lk);
-  r = lk->locked && (lk->pid == myproc()->pid);
+  r = lk->locked && (lk->owner == myproc());
   release(&lk->lk);
   return r;
 }
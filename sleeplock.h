@@ -3,8 +3,15 @@ struct sleeplock {
   uint locked;       // Is the lock held?
   struct spinlock lk; // spinlock protecting this sleep lock
   
+  struct proc *owner; // Process holding lock
+  int nwaiters;      // Processes sleeping in acquiresleep()
+
   // For debugging:
   char *name;        // Name of lock.
   int pid;           // Process holding lock
+
+  // For lockstat:
+  struct lockclass *cls; // Statistics bucket for this lock's name.
+  uint64 tacquire;       // rdtsc when the lock was acquired.
 };
 
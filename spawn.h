@@ -0,0 +1,16 @@
+// File actions for spawn(), done in order on the child's copy
+// of the parent's file descriptors before it starts.  If action
+// i fails, spawn() returns -2-i.
+#define SPAWN_CLOSE 1  // close fd
+#define SPAWN_DUP2  2  // make newfd a copy of fd
+#define SPAWN_OPEN  3  // open path with mode as fd
+
+#define SPAWN_MAXACT 16  // most actions in one spawn()
+
+struct spawnact {
+	int op;
+	int fd;
+	int newfd;    // SPAWN_DUP2
+	char *path;   // SPAWN_OPEN
+	int mode;     // SPAWN_OPEN
+};
@@ -0,0 +1,48 @@
+#include "types.h"
+#include "user.h"
+#include "spawn.h"
+
+// usage: spawnbench [n] [kbytes]
+//
+// Starts a program that exits at once n times (default 50) with
+// fork() and exec(), then with spawn(), and prints the ticks
+// each way took.  The parent first grows its heap by kbytes
+// (default 256), which fork() has to copy and spawn() does not.
+
+int main(int argc, char **argv) {
+	char *args[] = {"spawnbench", "-x", 0};
+	int n = argc > 1 ? atoi(argv[1]) : 50, kb = argc > 2 ? atoi(argv[2]) : 256;
+	int i, t, t1, t2;
+	char *heap;
+
+	if (argc > 1 && strcmp(argv[1], "-x") == 0)
+		exit();
+	if ((heap = sbrk(kb * 1024)) == (char *)-1) {
+		printf(2, "spawnbench: sbrk failed\n");
+		exit();
+	}
+	memset(heap, 1, kb * 1024);
+
+	t = uptime();
+	for (i = 0; i < n; i++) {
+		if (fork() == 0) {
+			exec(args[0], args);
+			printf(2, "spawnbench: exec failed\n");
+			exit();
+		}
+		wait();
+	}
+	t1 = uptime() - t;
+
+	t = uptime();
+	for (i = 0; i < n; i++) {
+		if (spawn(args[0], args, 0, 0) < 0) {
+			printf(2, "spawnbench: spawn failed\n");
+			exit();
+		}
+		wait();
+	}
+	t2 = uptime() - t;
+	printf(1, "%d launches, %d KB heap: fork+exec %d ticks, spawn %d ticks\n", n, kb, t1, t2);
+	exit();
+}
@@ -8,6 +8,7 @@
 #include "mmu.h"
 #include "proc.h"
 #include "spinlock.h"
+#include "lockstat.h"
 
 void
 initlock(struct spinlock *lk, char *name)
@@ -15,6 +16,7 @@ initlock(struct spinlock *lk, char *name)
   lk->name = name;
   lk->locked = 0;
   lk->cpu = 0;
+  lk->cls = lockclass(name, 0);
 }
 
 // Acquire the lock.
@@ -24,13 +26,24 @@ initlock(struct spinlock *lk, char *name)
 void
 acquire(struct spinlock *lk)
 {
+  uint64 t0, wait;
+  int contended;
+
   pushcli(); // disable interrupts to avoid deadlock.
   if(holding(lk))
     panic("acquire");
 
   // The xchg is atomic.
-  while(xchg(&lk->locked, 1) != 0)
-    ;
+  // Only read the cycle counter if we actually have to spin.
+  contended = 0;
+  wait = 0;
+  if(xchg(&lk->locked, 1) != 0){
+    contended = 1;
+    t0 = rdtsc();
+    while(xchg(&lk->locked, 1) != 0)
+      ;
+    wait = rdtsc() - t0;
+  }
 
   // Tell the C compiler and the processor to not move loads or stores
   // past this point, to ensure that the critical section's memory
@@ -40,6 +53,8 @@ acquire(struct spinlock *lk)
   // Record info about lock acquisition for debugging.
   lk->cpu = mycpu();
   getcallerpcs(&lk, lk->pcs);
+  lk->tacquire = rdtsc();
+  lockstat_acquire(lk->cls, contended, wait);
 }
 
 // Release the lock.
@@ -49,6 +64,8 @@ release(struct spinlock *lk)
   if(!holding(lk))
     panic("release");
 
+  lockstat_release(lk->cls, rdtsc() - lk->tacquire);
+
   lk->pcs[0] = 0;
   lk->cpu = 0;
 
@@ -124,3 +141,126 @@ popcli(void)
     sti();
 }
 
+//PAGEBREAK!
+// Lock contention statistics.
+//
+// Locks are grouped into classes by name, so that e.g. all
+// "pipe" locks or all "buffer" sleep locks share one entry.
+// Counters are kept per CPU and only updated by the owning
+// CPU with interrupts off, so no atomic operations are needed;
+// get_lockstat() sums them.
+
+struct lockcpustat {
+  uint acquires;
+  uint contended;
+  uint64 wait;
+  uint64 hold;
+  uint64 maxhold;
+};
+
+struct lockclass {
+  char *name;
+  int sleep;
+  struct lockcpustat cpu[NCPU];
+};
+
+static struct {
+  uint locked;  // guards registration; see lockclass()
+  int n;
+  struct lockclass cls[NLOCKSTAT];
+} lstat;
+
+// Find or create the class for locks called name.
+// Called from initlock(), which may run before the cpus[]
+// table is set up, so this uses a bare xchg rather than
+// a struct spinlock.
+struct lockclass*
+lockclass(char *name, int sleep)
+{
+  struct lockclass *c;
+
+  while(xchg(&lstat.locked, 1) != 0)
+    ;
+  for(c = lstat.cls; c < lstat.cls + lstat.n; c++)
+    if(c->sleep == sleep && strncmp(c->name, name, 16) == 0)
+      goto out;
+  if(lstat.n == NLOCKSTAT){
+    // Table full: account to the last class.
+    c = &lstat.cls[NLOCKSTAT-1];
+    goto out;
+  }
+  c = &lstat.cls[lstat.n++];
+  c->name = name;
+  c->sleep = sleep;
+out:
+  xchg(&lstat.locked, 0);
+  return c;
+}
+
+// Record an acquisition of a lock in class c.
+// Must be called with interrupts off.
+void
+lockstat_acquire(struct lockclass *c, int contended, uint64 wait)
+{
+  struct lockcpustat *s;
+
+  if(c == 0)
+    return;
+  s = &c->cpu[mycpu() - cpus];
+  s->acquires++;
+  if(contended){
+    s->contended++;
+    s->wait += wait;
+  }
+}
+
+// Record a release after the lock was held for hold cycles.
+// Must be called with interrupts off.
+void
+lockstat_release(struct lockclass *c, uint64 hold)
+{
+  struct lockcpustat *s;
+
+  if(c == 0)
+    return;
+  s = &c->cpu[mycpu() - cpus];
+  s->hold += hold;
+  if(hold > s->maxhold)
+    s->maxhold = hold;
+}
+
+// Copy up to n classes into li, then clear the counters if reset.
+// Returns the number of entries copied.
+int
+get_lockstat(struct lockinfo *li, int n, int reset)
+{
+  struct lockclass *c;
+  struct lockcpustat *s;
+  uint64 wait, hold, maxhold;
+  int i;
+
+  if(n > lstat.n)
+    n = lstat.n;
+  for(i = 0; i < n; i++){
+    c = &lstat.cls[i];
+    memset(&li[i], 0, sizeof(li[i]));
+    safestrcpy(li[i].name, c->name, sizeof(li[i].name));
+    li[i].sleep = c->sleep;
+    wait = hold = maxhold = 0;
+    for(s = c->cpu; s < &c->cpu[NCPU]; s++){
+      li[i].acquires += s->acquires;
+      li[i].contended += s->contended;
+      wait += s->wait;
+      hold += s->hold;
+      if(s->maxhold > maxhold)
+        maxhold = s->maxhold;
+    }
+    li[i].wait_kcycles = wait >> 10;
+    li[i].hold_kcycles = hold >> 10;
+    li[i].max_hold = maxhold > 0xffffffff ? 0xffffffff : maxhold;
+  }
+  if(reset)
+    for(c = lstat.cls; c < lstat.cls + lstat.n; c++)
+      memset(c->cpu, 0, sizeof(c->cpu));
+  return n;
+}
@@ -13,35 +13,52 @@
 // library system call function. The saved user %esp points
 // to a saved program counter, and then the first argument.
 
+// End of the user memory around addr in the current process:
+// sz for the heap, or the end of a file mapping or of an
+// attached shared memory segment.  Returns 0 if addr is not in
+// user memory.
+uint
+uvaend(uint addr)
+{
+  struct proc *curproc = myproc();
+
+  if(addr < curproc->sz)
+    return curproc->sz;
+  if(addr >= MMAPBASE && addr < SHMBASE)
+    return mmapend(curproc->pgdir, addr);
+  return shmend(curproc->pgdir, addr);
+}
+
 // Fetch the int at addr from the current process.
 int
 fetchint(uint addr, int *ip)
 {
-  struct proc *curproc = myproc();
-
-  if(addr >= curproc->sz || addr+4 > curproc->sz)
+  if(checkptr(addr, 4) < 0)
     return -1;
   *ip = *(int*)(addr);
   return 0;
 }
 
-// Fetch the nul-terminated string at addr from the current process.
-// Doesn't actually copy the string - just sets *pp to point at it.
-// Returns length of string, not including nul.
+// Copy the nul-terminated string at addr from the current
+// process into buf, which holds max bytes.  Other threads can
+// change the string at any time, so the kernel only ever looks
+// at the copy.  Returns length of string, not including nul,
+// or -1 if it does not fit.
 int
-fetchstr(uint addr, char **pp)
+fetchstr(uint addr, char *buf, int max)
 {
-  char *s, *ep;
-  struct proc *curproc = myproc();
+  uint end;
+  int i;
 
-  if(addr >= curproc->sz)
+  if((end = uvaend(addr)) == 0)
     return -1;
-  *pp = (char*)addr;
-  ep = (char*)curproc->sz;
-  for(s = *pp; s < ep; s++){
-    if(*s == 0)
-      return s - *pp;
-  }
+  if(max > end - addr)
+    max = end - addr;
+  if(checkptr(addr, max) < 0)
+    return -1;
+  for(i = 0; i < max; i++)
+    if((buf[i] = ((char*)addr)[i]) == 0)
+      return i;
   return -1;
 }
 
@@ -52,6 +69,23 @@ argint(int n, int *ip)
   return fetchint((myproc()->tf->esp) + 4 + 4*n, ip);
 }
 
+// Check that the block of memory of size bytes at addr lies
+// within the process address space, and fault it in if it is
+// mapped from a file (see mmap.c).  It stays pinned until the
+// system call returns, so other threads cannot free it under
+// the kernel (see uvmpin()).
+int
+checkptr(uint addr, int size)
+{
+  uint end;
+
+  if(size < 0 || uvmpin(addr, size) < 0)
+    return -1;
+  if((end = uvaend(addr)) == 0 || addr+size > end)
+    return -1;
+  return mmapprefault(addr, size);
+}
+
 // Fetch the nth word-sized system call argument as a pointer
 // to a block of memory of size bytes.  Check that the pointer
 // lies within the process address space.
@@ -59,27 +93,24 @@ int
 argptr(int n, char **pp, int size)
 {
   int i;
-  struct proc *curproc = myproc();
  
   if(argint(n, &i) < 0)
     return -1;
-  if(size < 0 || (uint)i >= curproc->sz || (uint)i+size > curproc->sz)
+  if(checkptr(i, size) < 0)
     return -1;
   *pp = (char*)i;
   return 0;
 }
 
-// Fetch the nth word-sized system call argument as a string pointer.
-// Check that the pointer is valid and the string is nul-terminated.
-// (There is no shared writable memory, so the string can't change
-// between this check and being used by the kernel.)
+// Fetch the nth word-sized system call argument as a string
+// pointer, and copy the string into buf, which holds max bytes.
 int
-argstr(int n, char **pp)
+argstr(int n, char *buf, int max)
 {
   int addr;
   if(argint(n, &addr) < 0)
     return -1;
-  return fetchstr(addr, pp);
+  return fetchstr(addr, buf, max);
 }
 
 extern int sys_chdir(void);
@@ -106,6 +137,37 @@ extern int sys_waitx(void);
 extern int sys_write(void);
 extern int sys_uptime(void);
 extern int sys_get_pinfos(void);
+extern int sys_get_lockstat(void);
+extern int sys_profctl(void);
+extern int sys_profread(void);
+extern int sys_tracectl(void);
+extern int sys_traceread(void);
+extern int sys_getiostat(void);
+extern int sys_sched_deadline(void);
+extern int sys_schedctl(void);
+extern int sys_sched_setaffinity(void);
+extern int sys_sched_getaffinity(void);
+extern int sys_wait4(void);
+extern int sys_cpustat(void);
+extern int sys_clone(void);
+extern int sys_join(void);
+extern int sys_futex_wait(void);
+extern int sys_futex_wake(void);
+extern int sys_shmget(void);
+extern int sys_shmat(void);
+extern int sys_shmdt(void);
+extern int sys_mmap(void);
+extern int sys_munmap(void);
+extern int sys_pread(void);
+extern int sys_pwrite(void);
+extern int sys_readv(void);
+extern int sys_writev(void);
+extern int sys_copy_file_range(void);
+extern int sys_uring_setup(void);
+extern int sys_uring_enter(void);
+extern int sys_poll(void);
+extern int sys_fcntl(void);
+extern int sys_spawn(void);
 
 static int (*syscalls[])(void) = {
 [SYS_fork]    sys_fork,
@@ -132,6 +194,37 @@ static int (*syscalls[])(void) = {
 [SYS_waitx]   sys_waitx,
 [SYS_set_priority] sys_set_priority,
 [SYS_get_pinfos] sys_get_pinfos,
+[SYS_get_lockstat] sys_get_lockstat,
+[SYS_profctl]  sys_profctl,
+[SYS_profread] sys_profread,
+[SYS_tracectl] sys_tracectl,
+[SYS_traceread] sys_traceread,
+[SYS_getiostat] sys_getiostat,
+[SYS_sched_deadline] sys_sched_deadline,
+[SYS_schedctl] sys_schedctl,
+[SYS_sched_setaffinity] sys_sched_setaffinity,
+[SYS_sched_getaffinity] sys_sched_getaffinity,
+[SYS_wait4]   sys_wait4,
+[SYS_cpustat] sys_cpustat,
+[SYS_clone]   sys_clone,
+[SYS_join]    sys_join,
+[SYS_futex_wait] sys_futex_wait,
+[SYS_futex_wake] sys_futex_wake,
+[SYS_shmget]  sys_shmget,
+[SYS_shmat]   sys_shmat,
+[SYS_shmdt]   sys_shmdt,
+[SYS_mmap]    sys_mmap,
+[SYS_munmap]  sys_munmap,
+[SYS_pread]   sys_pread,
+[SYS_pwrite]  sys_pwrite,
+[SYS_readv]   sys_readv,
+[SYS_writev]  sys_writev,
+[SYS_copy_file_range] sys_copy_file_range,
+[SYS_uring_setup] sys_uring_setup,
+[SYS_uring_enter] sys_uring_enter,
+[SYS_poll]    sys_poll,
+[SYS_fcntl]   sys_fcntl,
+[SYS_spawn]   sys_spawn,
 };
 
 void
@@ -141,8 +234,11 @@ syscall(void)
   struct proc *curproc = myproc();
 
   num = curproc->tf->eax;
+  curproc->nsyscalls++;
   if(num > 0 && num < NELEM(syscalls) && syscalls[num]) {
     curproc->tf->eax = syscalls[num]();
+    uvmunpin();
+    fdrelease();
   } else {
     cprintf("%d %s: unknown sys call %d\n",
             curproc->pid, curproc->name, num);
@@ -23,3 +23,34 @@
 #define SYS_waitx  22
 #define SYS_set_priority 23
 #define SYS_get_pinfos   24
+#define SYS_get_lockstat 25
+#define SYS_profctl      26
+#define SYS_profread     27
+#define SYS_tracectl     28
+#define SYS_traceread    29
+#define SYS_getiostat    30
+#define SYS_sched_deadline 31
+#define SYS_schedctl     32
+#define SYS_sched_setaffinity 33
+#define SYS_sched_getaffinity 34
+#define SYS_wait4        35
+#define SYS_cpustat      36
+#define SYS_clone        37
+#define SYS_join         38
+#define SYS_futex_wait   39
+#define SYS_futex_wake   40
+#define SYS_shmget       41
+#define SYS_shmat        42
+#define SYS_shmdt        43
+#define SYS_mmap         44
+#define SYS_munmap       45
+#define SYS_pread        46
+#define SYS_pwrite       47
+#define SYS_readv        48
+#define SYS_writev       49
+#define SYS_copy_file_range 50
+#define SYS_uring_setup 51
+#define SYS_uring_enter 52
+#define SYS_poll         53
+#define SYS_fcntl        54
+#define SYS_spawn        55
@@ -15,18 +15,33 @@
 #include "sleeplock.h"
 #include "file.h"
 #include "fcntl.h"
+#include "uio.h"
+#include "poll.h"
+#include "spawn.h"
 
 // Fetch the nth word-sized system call argument as a file descriptor
 // and return both the descriptor and the corresponding struct file.
+// If threads share the file table, another one could close the
+// file meanwhile, so the system call holds a reference to it
+// until it returns (see fdrelease()).
 static int
 argfd(int n, int *pfd, struct file **pf)
 {
   int fd;
   struct file *f;
+  struct proc *curproc = myproc();
 
   if(argint(n, &fd) < 0)
     return -1;
-  if(fd < 0 || fd >= NOFILE || (f=myproc()->ofile[fd]) == 0)
+  if(fd < 0 || fd >= NOFILE)
+    return -1;
+  if(curproc->fdt->ref == 1)
+    f = curproc->fdt->ofile[fd];
+  else if(curproc->nfhold < NFDHOLD && (f = fdget(curproc->fdt, fd)) != 0)
+    curproc->fhold[curproc->nfhold++] = f;
+  else
+    return -1;
+  if(f == 0)
     return -1;
   if(pfd)
     *pfd = fd;
@@ -35,20 +50,34 @@ argfd(int n, int *pfd, struct file **pf)
   return 0;
 }
 
+// Drop the references argfd() took for the system call that is
+// returning.
+void
+fdrelease(void)
+{
+  struct proc *curproc = myproc();
+
+  while(curproc->nfhold > 0)
+    fileclose(curproc->fhold[--curproc->nfhold]);
+}
+
 // Allocate a file descriptor for the given file.
 // Takes over file reference from caller on success.
 static int
 fdalloc(struct file *f)
 {
   int fd;
-  struct proc *curproc = myproc();
+  struct fdtable *t = myproc()->fdt;
 
+  acquire(&t->lock);
   for(fd = 0; fd < NOFILE; fd++){
-    if(curproc->ofile[fd] == 0){
-      curproc->ofile[fd] = f;
+    if(t->ofile[fd] == 0){
+      t->ofile[fd] = f;
+      release(&t->lock);
       return fd;
     }
   }
+  release(&t->lock);
   return -1;
 }
 
@@ -75,7 +104,9 @@ sys_read(void)
 
   if(argfd(0, 0, &f) < 0 || argint(2, &n) < 0 || argptr(1, &p, n) < 0)
     return -1;
-  return fileread(f, p, n);
+  if((n = fileread(f, p, n)) > 0)
+    myproc()->rbytes += n;
+  return n;
 }
 
 int
@@ -87,22 +118,162 @@ sys_write(void)
 
   if(argfd(0, 0, &f) < 0 || argint(2, &n) < 0 || argptr(1, &p, n) < 0)
     return -1;
-  return filewrite(f, p, n);
+  if((n = filewrite(f, p, n)) > 0)
+    myproc()->wbytes += n;
+  return n;
+}
+
+// Fetch the iovec array of argument n with cnt entries, argument
+// n+1, into iov, checking the buffers it points to.
+static int
+argiov(int n, struct iovec *iov, int *cnt)
+{
+  struct iovec *uiov;
+  int i;
+
+  if(argint(n+1, cnt) < 0 || *cnt < 0 || *cnt > IOV_MAX)
+    return -1;
+  if(argptr(n, (void*)&uiov, *cnt * sizeof(*uiov)) < 0)
+    return -1;
+  // Copy first: another thread could change it after the checks.
+  memmove(iov, uiov, *cnt * sizeof(*uiov));
+  for(i = 0; i < *cnt; i++)
+    if((int)iov[i].iov_len < 0 || checkptr((uint)iov[i].iov_base, iov[i].iov_len) < 0)
+      return -1;
+  return 0;
 }
 
 int
-sys_close(void)
+sys_readv(void)
+{
+  struct file *f;
+  struct iovec iov[IOV_MAX];
+  int n, cnt;
+
+  if(argfd(0, 0, &f) < 0 || argiov(1, iov, &cnt) < 0)
+    return -1;
+  if((n = filereadv(f, iov, cnt, 0)) > 0)
+    myproc()->rbytes += n;
+  return n;
+}
+
+int
+sys_writev(void)
+{
+  struct file *f;
+  struct iovec iov[IOV_MAX];
+  int n, cnt;
+
+  if(argfd(0, 0, &f) < 0 || argiov(1, iov, &cnt) < 0)
+    return -1;
+  if((n = filewritev(f, iov, cnt, 0)) > 0)
+    myproc()->wbytes += n;
+  return n;
+}
+
+// Like read and write, at offset off and leaving the file
+// offset alone.
+int
+sys_pread(void)
+{
+  struct file *f;
+  struct iovec iov;
+  int n, off;
+  char *p;
+
+  if(argfd(0, 0, &f) < 0 || argint(2, &n) < 0 || argptr(1, &p, n) < 0 ||
+     argint(3, &off) < 0 || off < 0)
+    return -1;
+  iov.iov_base = p;
+  iov.iov_len = n;
+  if((n = filereadv(f, &iov, 1, (uint*)&off)) > 0)
+    myproc()->rbytes += n;
+  return n;
+}
+
+int
+sys_pwrite(void)
 {
-  int fd;
   struct file *f;
+  struct iovec iov;
+  int n, off;
+  char *p;
+
+  if(argfd(0, 0, &f) < 0 || argint(2, &n) < 0 || argptr(1, &p, n) < 0 ||
+     argint(3, &off) < 0 || off < 0)
+    return -1;
+  iov.iov_base = p;
+  iov.iov_len = n;
+  if((n = filewritev(f, &iov, 1, (uint*)&off)) > 0)
+    myproc()->wbytes += n;
+  return n;
+}
+
+// Copy between two files inside the kernel.  The offset
+// pointers may be 0 to use and advance the file offsets; no
+// flags are defined.
+int
+sys_copy_file_range(void)
+{
+  struct file *in, *out;
+  uint *uinoff, *uoutoff, inoff, outoff;
+  int p, n, flags;
 
-  if(argfd(0, &fd, &f) < 0)
+  if(argfd(0, 0, &in) < 0 || argfd(2, 0, &out) < 0 ||
+     argint(4, &n) < 0 || n < 0 || argint(5, &flags) < 0 || flags != 0)
+    return -1;
+  uinoff = uoutoff = 0;
+  inoff = outoff = 0;
+  if(argint(1, &p) < 0 || (p && argptr(1, (void*)&uinoff, sizeof(uint)) < 0))
+    return -1;
+  if(argint(3, &p) < 0 || (p && argptr(3, (void*)&uoutoff, sizeof(uint)) < 0))
     return -1;
-  myproc()->ofile[fd] = 0;
+  if(uinoff)
+    inoff = *uinoff;
+  if(uoutoff)
+    outoff = *uoutoff;
+  n = filecopy(in, uinoff ? &inoff : 0, out, uoutoff ? &outoff : 0, n);
+  if(uinoff)
+    *uinoff = inoff;
+  if(uoutoff)
+    *uoutoff = outoff;
+  if(n > 0){
+    myproc()->rbytes += n;
+    myproc()->wbytes += n;
+  }
+  return n;
+}
+
+// Close file descriptor fd of the current process.
+int
+fdclose(int fd)
+{
+  struct file *f;
+  struct fdtable *t = myproc()->fdt;
+
+  if(fd < 0 || fd >= NOFILE)
+    return -1;
+  acquire(&t->lock);
+  if((f = t->ofile[fd]) == 0){
+    release(&t->lock);
+    return -1;
+  }
+  t->ofile[fd] = 0;
+  release(&t->lock);
   fileclose(f);
   return 0;
 }
 
+int
+sys_close(void)
+{
+  int fd;
+
+  if(argint(0, &fd) < 0)
+    return -1;
+  return fdclose(fd);
+}
+
 int
 sys_fstat(void)
 {
@@ -114,14 +285,46 @@ sys_fstat(void)
   return filestat(f, st);
 }
 
+// Only O_NONBLOCK can be changed.
+int
+sys_fcntl(void)
+{
+  struct file *f;
+  int cmd, arg;
+
+  if(argfd(0, 0, &f) < 0 || argint(1, &cmd) < 0 || argint(2, &arg) < 0)
+    return -1;
+  switch(cmd){
+  case F_GETFL:
+    arg = f->writable ? (f->readable ? O_RDWR : O_WRONLY) : O_RDONLY;
+    return arg | (f->nonblock ? O_NONBLOCK : 0);
+  case F_SETFL:
+    f->nonblock = (arg & O_NONBLOCK) != 0;
+    return 0;
+  }
+  return -1;
+}
+
+int
+sys_poll(void)
+{
+  struct pollfd *fds;
+  int n, timeout;
+
+  if(argint(1, &n) < 0 || n < 0 || n > NOFILE || argint(2, &timeout) < 0 ||
+     argptr(0, (void*)&fds, n*sizeof(*fds)) < 0)
+    return -1;
+  return poll(fds, n, timeout);
+}
+
 // Create the path new as a link to the same inode as old.
 int
 sys_link(void)
 {
-  char name[DIRSIZ], *new, *old;
+  char name[DIRSIZ], new[MAXPATH], old[MAXPATH];
   struct inode *dp, *ip;
 
-  if(argstr(0, &old) < 0 || argstr(1, &new) < 0)
+  if(argstr(0, old, MAXPATH) < 0 || argstr(1, new, MAXPATH) < 0)
     return -1;
 
   begin_op();
@@ -186,10 +389,10 @@ sys_unlink(void)
 {
   struct inode *ip, *dp;
   struct dirent de;
-  char name[DIRSIZ], *path;
+  char name[DIRSIZ], path[MAXPATH];
   uint off;
 
-  if(argstr(0, &path) < 0)
+  if(argstr(0, path, MAXPATH) < 0)
     return -1;
 
   begin_op();
@@ -282,44 +485,39 @@ create(char *path, short type, short major, short minor)
   return ip;
 }
 
-int
-sys_open(void)
+// Open path with omode and return the open file, not yet in
+// any process's file table, or 0.
+struct file*
+fileopen(char *path, int omode)
 {
-  char *path;
-  int fd, omode;
   struct file *f;
   struct inode *ip;
 
-  if(argstr(0, &path) < 0 || argint(1, &omode) < 0)
-    return -1;
-
   begin_op();
 
   if(omode & O_CREATE){
     ip = create(path, T_FILE, 0, 0);
     if(ip == 0){
       end_op();
-      return -1;
+      return 0;
     }
   } else {
     if((ip = namei(path)) == 0){
       end_op();
-      return -1;
+      return 0;
     }
     ilock(ip);
     if(ip->type == T_DIR && omode != O_RDONLY){
       iunlockput(ip);
       end_op();
-      return -1;
+      return 0;
     }
   }
 
-  if((f = filealloc()) == 0 || (fd = fdalloc(f)) < 0){
-    if(f)
-      fileclose(f);
+  if((f = filealloc()) == 0){
     iunlockput(ip);
     end_op();
-    return -1;
+    return 0;
   }
   iunlock(ip);
   end_op();
@@ -329,17 +527,50 @@ sys_open(void)
   f->off = 0;
   f->readable = !(omode & O_WRONLY);
   f->writable = (omode & O_WRONLY) || (omode & O_RDWR);
+  f->nonblock = (omode & O_NONBLOCK) != 0;
+  return f;
+}
+
+// Open path for the current process and return the new file
+// descriptor, or -1.
+int
+fdopen(char *path, int omode)
+{
+  struct file *f;
+  int fd;
+
+  if((f = fileopen(path, omode)) == 0)
+    return -1;
+  if((fd = fdalloc(f)) < 0){
+    fileclose(f);
+    return -1;
+  }
   return fd;
 }
 
+int
+sys_open(void)
+{
+  char path[MAXPATH];
+  int omode;
+
+  if(argstr(0, path, MAXPATH) < 0 || argint(1, &omode) < 0)
+    return -1;
+  return fdopen(path, omode);
+}
+
 int
 sys_mkdir(void)
 {
-  char *path;
+  char path[MAXPATH];
   struct inode *ip;
 
+  // Before begin_op(): checking the path may take mm.lock,
+  // which comes before the log.
+  if(argstr(0, path, MAXPATH) < 0)
+    return -1;
   begin_op();
-  if(argstr(0, &path) < 0 || (ip = create(path, T_DIR, 0, 0)) == 0){
+  if((ip = create(path, T_DIR, 0, 0)) == 0){
     end_op();
     return -1;
   }
@@ -352,14 +583,15 @@ int
 sys_mknod(void)
 {
   struct inode *ip;
-  char *path;
+  char path[MAXPATH];
   int major, minor;
 
-  begin_op();
-  if((argstr(0, &path)) < 0 ||
+  if((argstr(0, path, MAXPATH)) < 0 ||
      argint(1, &major) < 0 ||
-     argint(2, &minor) < 0 ||
-     (ip = create(path, T_DEV, major, minor)) == 0){
+     argint(2, &minor) < 0)
+    return -1;
+  begin_op();
+  if((ip = create(path, T_DEV, major, minor)) == 0){
     end_op();
     return -1;
   }
@@ -371,12 +603,14 @@ sys_mknod(void)
 int
 sys_chdir(void)
 {
-  char *path;
+  char path[MAXPATH];
   struct inode *ip;
   struct proc *curproc = myproc();
   
+  if(argstr(0, path, MAXPATH) < 0)
+    return -1;
   begin_op();
-  if(argstr(0, &path) < 0 || (ip = namei(path)) == 0){
+  if((ip = namei(path)) == 0){
     end_op();
     return -1;
   }
@@ -393,19 +627,20 @@ sys_chdir(void)
   return 0;
 }
 
-int
-sys_exec(void)
+// Fetch the null-terminated argument vector at user address
+// uargv into argv, which has room for MAXARG pointers, copying
+// the strings into the page buf.  Returns the bytes of buf
+// used, or -1.
+static int
+fetchargv(uint uargv, char **argv, char *buf)
 {
-  char *path, *argv[MAXARG];
-  int i;
-  uint uargv, uarg;
+  int i, n, off;
+  uint uarg;
 
-  if(argstr(0, &path) < 0 || argint(1, (int*)&uargv) < 0){
-    return -1;
-  }
-  memset(argv, 0, sizeof(argv));
+  memset(argv, 0, MAXARG*sizeof(argv[0]));
+  off = 0;
   for(i=0;; i++){
-    if(i >= NELEM(argv))
+    if(i >= MAXARG)
       return -1;
     if(fetchint(uargv+4*i, (int*)&uarg) < 0)
       return -1;
@@ -413,10 +648,66 @@ sys_exec(void)
       argv[i] = 0;
       break;
     }
-    if(fetchstr(uarg, &argv[i]) < 0)
+    if((n = fetchstr(uarg, buf + off, PGSIZE - off)) < 0)
       return -1;
+    argv[i] = buf + off;
+    off += n + 1;
+  }
+  return off;
+}
+
+int
+sys_exec(void)
+{
+  char path[MAXPATH], *argv[MAXARG], *buf;
+  uint uargv;
+  int r;
+
+  if(argstr(0, path, MAXPATH) < 0 || argint(1, (int*)&uargv) < 0){
+    return -1;
+  }
+  if((buf = kalloc()) == 0)
+    return -1;
+  r = -1;
+  if(fetchargv(uargv, argv, buf) >= 0)
+    r = exec(path, argv);
+  kfree(buf);
+  return r;
+}
+
+int
+sys_spawn(void)
+{
+  char path[MAXPATH], *argv[MAXARG], *buf, *upath;
+  struct spawnact *uact, act[SPAWN_MAXACT];
+  uint uargv;
+  int i, n, len, off, r;
+
+  if(argstr(0, path, MAXPATH) < 0 || argint(1, (int*)&uargv) < 0 ||
+     argint(3, &n) < 0 || n < 0 || n > SPAWN_MAXACT ||
+     argptr(2, (void*)&uact, n*sizeof(act[0])) < 0)
+    return -1;
+  if((buf = kalloc()) == 0)
+    return -1;
+  r = -1;
+  if((off = fetchargv(uargv, argv, buf)) < 0)
+    goto out;
+  // Copy the actions and their paths, so that another thread
+  // cannot change them after they have been checked.
+  memmove(act, uact, n*sizeof(act[0]));
+  for(i = 0; i < n; i++){
+    if(act[i].op != SPAWN_OPEN)
+      continue;
+    upath = act[i].path;
+    act[i].path = buf + off;
+    if((len = fetchstr((uint)upath, act[i].path, PGSIZE - off)) < 0)
+      goto out;
+    off += len + 1;
   }
-  return exec(path, argv);
+  r = spawn(path, argv, act, n);
+out:
+  kfree(buf);
+  return r;
 }
 
 int
@@ -433,8 +724,9 @@ sys_pipe(void)
   fd0 = -1;
   if((fd0 = fdalloc(rf)) < 0 || (fd1 = fdalloc(wf)) < 0){
     if(fd0 >= 0)
-      myproc()->ofile[fd0] = 0;
-    fileclose(rf);
+      fdclose(fd0);
+    else
+      fileclose(rf);
     fileclose(wf);
     return -1;
   }
@@ -442,3 +734,27 @@ sys_pipe(void)
   fd[1] = fd1;
   return 0;
 }
+
+// The address hint (argument 0) is ignored: mappings go at the
+// lowest free address above MMAPBASE.
+int
+sys_mmap(void)
+{
+  struct file *f;
+  int len, prot, flags, off;
+
+  if(argint(1, &len) < 0 || argint(2, &prot) < 0 || argint(3, &flags) < 0 ||
+     argfd(4, 0, &f) < 0 || argint(5, &off) < 0)
+    return -1;
+  return mmap(len, prot, flags, f, off);
+}
+
+int
+sys_munmap(void)
+{
+  int addr, len;
+
+  if(argint(0, &addr) < 0 || argint(1, &len) < 0)
+    return -1;
+  return munmap(addr, len);
+}
@@ -7,6 +7,13 @@
 #include "mmu.h"
 #include "proc.h"
 #include "pinfo.h"
+#include "lockstat.h"
+#include "prof.h"
+#include "trace.h"
+#include "iostat.h"
+#include "schedctl.h"
+#include "rusage.h"
+#include "cpustat.h"
 
 int
 sys_fork(void)
@@ -51,8 +58,9 @@ sys_sbrk(void)
 
   if(argint(0, &n) < 0)
     return -1;
-  addr = myproc()->sz;
-  if(growproc(n) < 0)
+  // The old size comes from growproc: another thread may be
+  // growing the address space at the same time.
+  if((addr = growproc(n)) < 0)
     return -1;
   return addr;
 }
@@ -118,3 +126,202 @@ int sys_get_pinfos(void){
   int n = get_pinfos(p);
   return n;
 }
+
+int sys_get_lockstat(void) {
+	struct lockinfo *li;
+	int n, reset;
+
+	if (argint(1, &n) < 0 || argint(2, &reset) < 0 || n < 0)
+		return -1;
+	if (n > NLOCKSTAT)  // no more to return, and n * size cannot overflow
+		n = NLOCKSTAT;
+	if (argptr(0, (char **)&li, n * sizeof(*li)) < 0)
+		return -1;
+	return get_lockstat(li, n, reset);
+}
+
+int sys_profctl(void) {
+	int on;
+
+	if (argint(0, &on) < 0)
+		return -1;
+	return profctl(on != 0);
+}
+
+int sys_profread(void) {
+	struct profsample *buf;
+	int n;
+
+	if (argint(1, &n) < 0 || n < 0)
+		return -1;
+	if (n > NPROFSAMPLE * NCPU)  // all there can be buffered
+		n = NPROFSAMPLE * NCPU;
+	if (argptr(0, (char **)&buf, n * sizeof(*buf)) < 0)
+		return -1;
+	return profread(buf, n);
+}
+
+int sys_tracectl(void) {
+	int on;
+
+	if (argint(0, &on) < 0)
+		return -1;
+	return tracectl(on != 0);
+}
+
+int sys_traceread(void) {
+	struct schedevent *buf;
+	int n;
+
+	if (argint(1, &n) < 0 || n < 0)
+		return -1;
+	if (n > NTRACE * NCPU)  // all there can be buffered
+		n = NTRACE * NCPU;
+	if (argptr(0, (char **)&buf, n * sizeof(*buf)) < 0)
+		return -1;
+	return traceread(buf, n);
+}
+
+int sys_getiostat(void) {
+	struct iostat *st;
+	int reset;
+
+	if (argptr(0, (char **)&st, sizeof(*st)) < 0 || argint(1, &reset) < 0)
+		return -1;
+	bstat(st, reset);
+	pcstat(st, reset);
+	idestats(st, reset);
+	return 0;
+}
+
+int sys_sched_deadline(void) {
+	int runtime, period, deadline;
+
+	if (argint(0, &runtime) < 0 || argint(1, &period) < 0 ||
+		argint(2, &deadline) < 0)
+		return -1;
+	return sched_deadline(runtime, period, deadline);
+}
+
+// schedctl() works on a copy: another thread could change the
+// user's struct between the checks and their use.
+int sys_schedctl(void) {
+	struct schedparam *sp, ksp;
+	int op;
+
+	if (argint(0, &op) < 0 || argptr(1, (char **)&sp, sizeof(*sp)) < 0)
+		return -1;
+	ksp = *sp;
+	if (schedctl(op, &ksp) < 0)
+		return -1;
+	if (op == SCHEDCTL_GET)
+		*sp = ksp;
+	return 0;
+}
+
+int sys_sched_setaffinity(void) {
+	int pid, mask;
+
+	if (argint(0, &pid) < 0 || argint(1, &mask) < 0)
+		return -1;
+	return sched_setaffinity(pid, mask);
+}
+
+int sys_sched_getaffinity(void) {
+	int pid;
+
+	if (argint(0, &pid) < 0)
+		return -1;
+	return sched_getaffinity(pid);
+}
+
+int sys_wait4(void) {
+	struct rusage *ru;
+	int pid;
+
+	if (argint(0, &pid) < 0 || argptr(1, (char **)&ru, sizeof(*ru)) < 0)
+		return -1;
+	return wait4(pid, ru);
+}
+
+int sys_cpustat(void) {
+	struct sysstat *st;
+
+	if (argptr(0, (char **)&st, sizeof(*st)) < 0)
+		return -1;
+	return cpustat(st);
+}
+
+int sys_clone(void) {
+	int fn, arg1, arg2, stack;
+
+	if (argint(0, &fn) < 0 || argint(1, &arg1) < 0 || argint(2, &arg2) < 0 ||
+		argint(3, &stack) < 0)
+		return -1;
+	return clone((void (*)(void *, void *))fn, (void *)arg1, (void *)arg2,
+				 (void *)stack);
+}
+
+int sys_join(void) {
+	void **stack;
+
+	if (argptr(0, (char **)&stack, sizeof(*stack)) < 0)
+		return -1;
+	return join(stack);
+}
+
+int sys_futex_wait(void) {
+	int addr, val, timeout;
+
+	if (argint(0, &addr) < 0 || argint(1, &val) < 0 || argint(2, &timeout) < 0)
+		return -1;
+	return futex_wait(addr, val, timeout);
+}
+
+int sys_futex_wake(void) {
+	int addr, n;
+
+	if (argint(0, &addr) < 0 || argint(1, &n) < 0)
+		return -1;
+	return futex_wake(addr, n);
+}
+
+int sys_shmget(void) {
+	int key, size;
+
+	if (argint(0, &key) < 0 || argint(1, &size) < 0)
+		return -1;
+	return shmget(key, size);
+}
+
+int sys_shmat(void) {
+	int id;
+
+	if (argint(0, &id) < 0)
+		return -1;
+	return shmat(id);
+}
+
+int sys_shmdt(void) {
+	int addr;
+
+	if (argint(0, &addr) < 0)
+		return -1;
+	return shmdt(addr);
+}
+
+int sys_uring_setup(void) {
+	int addr;
+
+	if (argint(0, &addr) < 0)
+		return -1;
+	return uringsetup((struct uring *)addr);
+}
+
+int sys_uring_enter(void) {
+	int n, min;
+
+	if (argint(0, &n) < 0 || argint(1, &min) < 0)
+		return -1;
+	return uringenter(n, min);
+}
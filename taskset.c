@@ -0,0 +1,51 @@
+#include "types.h"
+#include "user.h"
+
+// usage: taskset mask cmd args...   run cmd on the CPUs in mask
+//        taskset -p mask pid        move process pid to them
+//        taskset -p pid             print the mask of process pid
+//
+// mask is in hex, bit i for CPU i, as for Linux's taskset.
+
+int hexmask(char *s) {
+	int m = 0;
+
+	if (s[0] == '0' && s[1] == 'x')
+		s += 2;
+	for (; *s; s++) {
+		if (*s >= '0' && *s <= '9')
+			m = m * 16 + *s - '0';
+		else if (*s >= 'a' && *s <= 'f')
+			m = m * 16 + *s - 'a' + 10;
+		else
+			return 0;
+	}
+	return m;
+}
+
+int main(int argc, char **argv) {
+	if (argc == 3 && strcmp(argv[1], "-p") == 0) {
+		int mask = sched_getaffinity(atoi(argv[2]));
+		if (mask < 0)
+			printf(2, "taskset: no process %s\n", argv[2]);
+		else
+			printf(1, "pid %s's affinity mask: %x\n", argv[2], mask);
+		exit();
+	}
+	if (argc == 4 && strcmp(argv[1], "-p") == 0) {
+		if (sched_setaffinity(atoi(argv[3]), hexmask(argv[2])) < 0)
+			printf(2, "taskset: cannot set pid %s to mask %s\n", argv[3], argv[2]);
+		exit();
+	}
+	if (argc < 3) {
+		printf(2, "usage: taskset mask cmd args... | taskset -p [mask] pid\n");
+		exit();
+	}
+	if (sched_setaffinity(0, hexmask(argv[1])) < 0) {
+		printf(2, "taskset: bad mask %s\n", argv[1]);
+		exit();
+	}
+	exec(argv[2], argv + 2);
+	printf(2, "taskset: exec %s failed\n", argv[2]);
+	exit();
+}
@@ -1,6 +1,8 @@
 #include "types.h"
+#include "param.h"
 #include "user.h"
 #include "stat.h"
+#include "rusage.h"
 
 int main(int argc, char **argv) {
 	if (argc <= 1) {
@@ -15,9 +17,20 @@ int main(int argc, char **argv) {
 		exec(argv[1], argv + 1);
 		printf(2, "time: error: couldn't run. \n");
 	} else {
-		int wtime, rtime;
-		waitx(&wtime, &rtime);
-		printf(1, "\nTime Taken: wtime= %d ;rtime= %d \n", wtime, rtime);
+		struct rusage ru;
+		if (wait4(pid, &ru) < 0) {
+			printf(2, "time: error: wait failed.\n");
+			exit();
+		}
+		printf(1, "\nTime Taken: wtime= %d ;rtime= %d \n", ru.wtime, ru.rtime);
+		printf(1, "context switches: %d voluntary, %d involuntary\n", ru.nvcsw, ru.nivcsw);
+		printf(1, "syscalls: %d  page faults: %d\n", ru.nsyscalls, ru.npgfaults);
+		printf(1, "bytes: %d read, %d written\n", ru.rbytes, ru.wbytes);
+		printf(1, "disk blocks: %d read, %d written\n", ru.rblocks, ru.wblocks);
+		printf(1, "run queue wait (cycles):\n");
+		for (int i = 0; i < NRUHIST; i++)
+			if (ru.rqwait[i])
+				printf(1, "  2^%d\t%d\n", i, ru.rqwait[i]);
 	}
 	exit();
 }
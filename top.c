@@ -0,0 +1,127 @@
+#include "types.h"
+#include "param.h"
+#include "user.h"
+#include "cpustat.h"
+
+// usage: top [-d ticks] [-n count]
+//        top [-d ticks] cmd args...
+//
+// Every ticks (default 100) prints how busy each CPU was and
+// how much CPU each process got since the previous refresh:
+// count times (default 10), or until cmd exits.
+
+struct sysstat snap[2];
+
+// part * 100 / whole, without 64-bit division.
+int pct(uint64 part, uint64 whole) {
+	while (whole >= (1 << 24)) {
+		part >>= 1;
+		whole >>= 1;
+	}
+	if (whole == 0)
+		return 0;
+	return (uint)part * 100 / (uint)whole;
+}
+
+uint64 sum(struct cpustat *c) {
+	uint64 t = 0;
+	for (int i = 0; i < NCPUSTATE; i++)
+		t += c->time[i];
+	return t;
+}
+
+// Cycles pid had in old, 0 if it was not there.
+uint64 before(struct sysstat *old, int pid) {
+	for (int i = 0; i < old->nproc; i++)
+		if (old->proc[i].pid == pid)
+			return old->proc[i].cycles;
+	return 0;
+}
+
+void show(struct sysstat *old, struct sysstat *cur) {
+	static uint64 delta[NPROC];
+	static int order[NPROC];
+	uint64 d[NCPUSTATE], all;
+	int i, j, t;
+
+	printf(1, "\nCPU\tuser%%\tsys%%\tirq%%\tidle%%\n");
+	for (i = 0; i < cur->ncpu; i++) {
+		for (j = 0; j < NCPUSTATE; j++)
+			d[j] = cur->cpu[i].time[j] - old->cpu[i].time[j];
+		all = sum(&cur->cpu[i]) - sum(&old->cpu[i]);
+		printf(1, "%d\t%d\t%d\t%d\t%d\n", i, pct(d[CPU_USER], all),
+			   pct(d[CPU_KERNEL], all), pct(d[CPU_IRQ], all),
+			   pct(d[CPU_IDLE], all));
+	}
+
+	// Busiest first.
+	for (i = 0; i < cur->nproc; i++) {
+		delta[i] = cur->proc[i].cycles - before(old, cur->proc[i].pid);
+		order[i] = i;
+	}
+	for (i = 1; i < cur->nproc; i++)
+		for (j = i; j > 0 && delta[order[j]] > delta[order[j - 1]]; j--) {
+			t = order[j];
+			order[j] = order[j - 1];
+			order[j - 1] = t;
+		}
+
+	printf(1, "PID\tCPU%%\tlast\tState\t\tName\n");
+	for (i = 0; i < cur->nproc; i++) {
+		struct procstat *p = &cur->proc[order[i]];
+		printf(1, "%d\t%d\t%d\t%s\t%s\n", p->pid,
+			   pct(delta[order[i]], cur->tsc - old->tsc), p->cpu, p->state,
+			   p->name);
+	}
+}
+
+// Is pid gone or a zombie in st?
+int exited(struct sysstat *st, int pid) {
+	for (int i = 0; i < st->nproc; i++)
+		if (st->proc[i].pid == pid)
+			return st->proc[i].state[0] == 'z';
+	return 1;
+}
+
+int main(int argc, char **argv) {
+	int delay = 100, count = 10, pid = 0, n;
+
+	argv++, argc--;
+	while (argc >= 2 && argv[0][0] == '-') {
+		if (strcmp(argv[0], "-d") == 0)
+			delay = atoi(argv[1]);
+		else if (strcmp(argv[0], "-n") == 0)
+			count = atoi(argv[1]);
+		else
+			break;
+		argv += 2, argc -= 2;
+	}
+	if (argc > 0 && argv[0][0] == '-') {
+		printf(2, "usage: top [-d ticks] [-n count] [cmd args...]\n");
+		exit();
+	}
+	if (argc > 0) {
+		pid = fork();
+		if (pid < 0) {
+			printf(2, "top: fork failed\n");
+			exit();
+		}
+		if (pid == 0) {
+			exec(argv[0], argv);
+			printf(2, "top: exec %s failed\n", argv[0]);
+			exit();
+		}
+	}
+
+	cpustat(&snap[0]);
+	for (n = 1; pid || n <= count; n++) {
+		sleep(delay);
+		cpustat(&snap[n % 2]);
+		show(&snap[(n + 1) % 2], &snap[n % 2]);
+		if (pid && exited(&snap[n % 2], pid))
+			break;
+	}
+	if (pid)
+		wait();
+	exit();
+}
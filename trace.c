@@ -0,0 +1,108 @@
+// Binary scheduler event trace.
+//
+// Scheduling events are recorded into per-CPU ring buffers,
+// with the same single-writer/single-reader scheme as prof.c:
+// only the owning CPU writes a ring (with interrupts off, and
+// usually holding ptable.lock) and traceread() drains them.
+// Nothing is printed, so tracing does not serialize CPUs on
+// console output the way the old LOGS cprintfs did.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "memlayout.h"
+#include "mmu.h"
+#include "proc.h"
+#include "x86.h"
+#include "spinlock.h"
+#include "trace.h"
+
+struct tracecpu {
+  uint head;     // next slot to fill; written only by the owning CPU
+  uint tail;     // next slot to read; written only by traceread()
+  uint dropped;  // events lost because the ring was full
+  struct schedevent buf[NTRACE];
+};
+
+static struct {
+  struct spinlock lock;
+  int on;
+  struct tracecpu cpu[NCPU];
+} trace;
+
+void
+traceinit(void)
+{
+  initlock(&trace.lock, "trace");
+}
+
+// Record a scheduling event of type for p.
+// Must be called with interrupts off.
+void
+schedtrace(int type, struct proc *p, int arg)
+{
+  struct tracecpu *tc;
+  struct schedevent *e;
+
+  if(!trace.on)
+    return;
+  tc = &trace.cpu[cpuid()];
+  if(tc->head - tc->tail >= NTRACE){
+    tc->dropped++;
+    return;
+  }
+  e = &tc->buf[tc->head % NTRACE];
+  e->tsc = rdtsc();
+  e->ticks = ticks;
+  e->pid = p->pid;
+  e->cpu = cpuid();
+  e->type = type;
+  e->arg = arg;
+  // Publish the event before the new head.
+  __sync_synchronize();
+  tc->head++;
+}
+
+// Turn tracing on or off.  Turning it on discards any events
+// still buffered.  Returns the number of events dropped since
+// tracing was last turned on.
+int
+tracectl(int on)
+{
+  struct tracecpu *tc;
+  int dropped;
+
+  acquire(&trace.lock);
+  dropped = 0;
+  for(tc = trace.cpu; tc < &trace.cpu[ncpu]; tc++){
+    dropped += tc->dropped;
+    if(on){
+      tc->tail = tc->head;
+      tc->dropped = 0;
+    }
+  }
+  trace.on = on;
+  release(&trace.lock);
+  return dropped;
+}
+
+// Move up to n buffered events into buf.
+// Returns the number of events copied.
+int
+traceread(struct schedevent *buf, int n)
+{
+  struct tracecpu *tc;
+  int i;
+
+  acquire(&trace.lock);
+  i = 0;
+  for(tc = trace.cpu; tc < &trace.cpu[ncpu]; tc++){
+    while(i < n && tc->tail != tc->head){
+      __sync_synchronize();
+      buf[i++] = tc->buf[tc->tail % NTRACE];
+      tc->tail++;
+    }
+  }
+  release(&trace.lock);
+  return i;
+}
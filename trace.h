@@ -0,0 +1,21 @@
+#define NTRACE 1024  // events buffered per CPU between traceread() calls
+
+// Scheduler event types.
+#define TR_DISPATCH 1  // scheduler switched to pid
+#define TR_PREEMPT  2  // pid gave up the CPU but is still runnable
+#define TR_SLEEP    3  // pid went to sleep
+#define TR_WAKEUP   4  // pid became runnable
+#define TR_QUEUE    5  // pid moved to MLFQ queue arg
+#define TR_EXIT     6  // pid exited
+
+// One scheduler event, as written to the file by schedtrace.
+// Packed so the on-disk layout is the same 20 bytes everywhere
+// (plot_graph.py reads it as "<QIHBBi").
+struct schedevent {
+	uint64 tsc;    // rdtsc on the recording CPU
+	uint ticks;    // ticks at the time of the event
+	ushort pid;
+	uchar cpu;     // CPU that recorded the event
+	uchar type;    // TR_*
+	int arg;       // MLFQ queue or PBS priority, -1 if none
+} __attribute__((packed));
@@ -7,6 +7,7 @@
 #include "x86.h"
 #include "traps.h"
 #include "spinlock.h"
+#include "cpustat.h"
 
 // Interrupt descriptor table (shared by all CPUs).
 struct gatedesc idt[256];
@@ -36,6 +37,14 @@ idtinit(void)
 void
 trap(struct trapframe *tf)
 {
+  int user = (tf->cs&3) == DPL_USER;
+  int prev = -1;
+
+  // CPU time accounting (cpustat.c): time out of user mode is
+  // kernel time, except while handling an interrupt.
+  if(user)
+    cpuacct(CPU_KERNEL);
+
   if(tf->trapno == T_SYSCALL){
     if(myproc()->killed)
       exit();
@@ -43,21 +52,44 @@ trap(struct trapframe *tf)
     syscall();
     if(myproc()->killed)
       exit();
+    cpuacct(CPU_USER);
     return;
   }
 
+  if(tf->trapno >= T_IRQ0)
+    prev = cpuacct(CPU_IRQ);
+
   switch(tf->trapno){
   case T_IRQ0 + IRQ_TIMER:
+    profsample(tf);
     if(cpuid() == 0){
       acquire(&tickslock);
       ticks++;
       update_proctime();
-	  age_procs();
+      wakeup_timeouts();
+      sched_clock();
 	  wakeup(&ticks);
       release(&tickslock);
     }
     lapiceoi();
     break;
+  case T_IRQ0 + IRQ_RESCHED:
+    // Another CPU made a process runnable that should preempt
+    // ours; the yield below does that.
+    mycpu()->need_resched = 0;
+    lapiceoi();
+    break;
+  case T_IRQ0 + IRQ_TLB:
+    // Another CPU unmapped pages of the address space we are
+    // on; reloading %cr3 drops every cached user translation.
+    // Clear the flag first, so that a shooter setting it
+    // while we are here gets its own IPI rather than seeing it
+    // cleared before its PTE changes were flushed.
+    mycpu()->tlbflush = 0;
+    __sync_synchronize();
+    lcr3(rcr3());
+    lapiceoi();
+    break;
   case T_IRQ0 + IRQ_IDE:
     ideintr();
     lapiceoi();
@@ -80,6 +112,20 @@ trap(struct trapframe *tf)
     lapiceoi();
     break;
 
+  case T_PGFLT:
+    // File mappings are filled in on demand (mmap.c).  The kernel
+    // faults in what a system call uses when checking it, and
+    // pins keep other threads from unmapping it or making it
+    // copy-on-write (uvmpin() in proc.c), so servicing a fault
+    // from the kernel is only a fallback, and only possible
+    // without a spinlock held.
+    if(myproc()){
+      myproc()->npgfaults++;
+      if((user || mycpu()->ncli == 0) && mmapfault(rcr2(), tf->err & 2) == 0)
+        break;
+    }
+    // fall through
+
   //PAGEBREAK: 13
   default:
     if(myproc() == 0 || (tf->cs&3) == 0){
@@ -95,6 +141,8 @@ trap(struct trapframe *tf)
             tf->err, cpuid(), tf->eip, rcr2());
     myproc()->killed = 1;
   }
+  if(prev >= 0)
+    cpuacct(prev);
 
   // Force process exit if it has been killed and is in user space.
   // (If it is still executing in the kernel, let it keep running
@@ -102,36 +150,18 @@ trap(struct trapframe *tf)
   if(myproc() && myproc()->killed && (tf->cs&3) == DPL_USER)
     exit();
 
-#if SCHEDULER == MLFQ_SCHED
-  struct proc *p = myproc();
-  if (p &&p->state == RUNNING &&tf->trapno == T_IRQ0 + IRQ_TIMER) {
-	  if (p->curr_rtime >= (1 << p->curr_q)) {
-		  p->used_limit = 1;
-#ifdef DEBUG
-		  // cprintf("limit");
-#endif
-		  yield();
-	  } else {
-#ifdef DEBUG
-		  // cprintf("in limit");
-#endif
-
-		  p->curr_rtime++;
-		  p->ticks_inq[p->curr_q]++;
-	  }
-  }
-#endif
-
-  // Force process to give up CPU on clock tick.
+  // Force process to give up CPU on clock tick, if the
+  // scheduler says so (see sched_tick), or on a reschedule IPI.
   // If interrupts were on while locks held, would need to check nlock.
-#if SCHEDULER != FCFS_SCHED
-#if SCHEDULER != MLFQ_SCHED
   if(myproc() && myproc()->state == RUNNING &&
-     tf->trapno == T_IRQ0+IRQ_TIMER)
+     ((tf->trapno == T_IRQ0+IRQ_TIMER && sched_tick()) ||
+      tf->trapno == T_IRQ0+IRQ_RESCHED))
     yield();
-#endif
-#endif
+
   // Check if the process has been killed since we yielded
   if(myproc() && myproc()->killed && (tf->cs&3) == DPL_USER)
     exit();
+
+  if(user)
+    cpuacct(CPU_USER);
 }
@@ -34,5 +34,7 @@
 #define IRQ_COM1         4
 #define IRQ_IDE         14
 #define IRQ_ERROR       19
+#define IRQ_TLB         29      // TLB shootdown IPI, see tlbshootdown() in vm.c
+#define IRQ_RESCHED     30      // reschedule IPI, see kick() in sched.c
 #define IRQ_SPURIOUS    31
 
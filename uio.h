@@ -0,0 +1,7 @@
+// Buffers for readv() and writev().
+struct iovec {
+  void *iov_base;
+  uint iov_len;
+};
+
+#define IOV_MAX 16  // most buffers in one readv() or writev()
@@ -3,6 +3,7 @@
 #include "fcntl.h"
 #include "user.h"
 #include "x86.h"
+#include "param.h"
 
 char*
 strcpy(char *s, const char *t)
@@ -104,3 +105,104 @@ memmove(void *vdst, const void *vsrc, int n)
     *dst++ = *src++;
   return vdst;
 }
+
+// Mutexes, condition variables and semaphores on futexes, after
+// Drepper's "Futexes Are Tricky".  Uncontended operations are a
+// single atomic instruction; only waiting and waking a waiter
+// enter the kernel.
+
+void
+mutex_lock(struct mutex *m)
+{
+  uint c;
+
+  if((c = __sync_val_compare_and_swap(&m->val, 0, 1)) == 0)
+    return;
+  // Contended: mark it as waited for and sleep until it is free.
+  if(c != 2)
+    c = xchg(&m->val, 2);
+  while(c != 0){
+    futex_wait(&m->val, 2, 0);
+    c = xchg(&m->val, 2);
+  }
+}
+
+// Take m if it is free.  Returns 1 if it was taken, 0 if not.
+int
+mutex_trylock(struct mutex *m)
+{
+  return __sync_val_compare_and_swap(&m->val, 0, 1) == 0;
+}
+
+void
+mutex_unlock(struct mutex *m)
+{
+  if(__sync_fetch_and_sub(&m->val, 1) != 1){
+    m->val = 0;
+    futex_wake(&m->val, 1);
+  }
+}
+
+// Release m, wait for a signal and take m again.  Gives up
+// waiting after timeout ticks unless timeout is 0.  Returns -1
+// on a timeout, 0 otherwise; like pthreads, wakeups may be
+// spurious, so callers re-check their condition.
+int
+cond_wait(struct cond *c, struct mutex *m, int timeout)
+{
+  uint seq = c->seq;
+  int r;
+
+  mutex_unlock(m);
+  r = futex_wait(&c->seq, seq, timeout);
+  mutex_lock(m);
+  return r;
+}
+
+void
+cond_signal(struct cond *c)
+{
+  __sync_fetch_and_add(&c->seq, 1);
+  futex_wake(&c->seq, 1);
+}
+
+void
+cond_broadcast(struct cond *c)
+{
+  __sync_fetch_and_add(&c->seq, 1);
+  futex_wake(&c->seq, NPROC);
+}
+
+void
+sem_init(struct sem *s, uint count)
+{
+  s->count = count;
+  s->waiters = 0;
+}
+
+void
+sem_wait(struct sem *s)
+{
+  uint c;
+
+  for(;;){
+    c = s->count;
+    if(c > 0){
+      if(__sync_val_compare_and_swap(&s->count, c, c - 1) == c)
+        return;
+      continue;
+    }
+    // futex_wait returns at once if a sem_post got in first.
+    __sync_fetch_and_add(&s->waiters, 1);
+    futex_wait(&s->count, 0, 0);
+    __sync_fetch_and_sub(&s->waiters, 1);
+  }
+}
+
+void
+sem_post(struct sem *s)
+{
+  __sync_fetch_and_add(&s->count, 1);
+  if(s->waiters)
+    futex_wake(&s->count, 1);
+}
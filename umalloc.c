@@ -20,9 +20,10 @@ typedef union header Header;
 
 static Header base;
 static Header *freep;
+static struct mutex lock;  // threads share the heap
 
-void
-free(void *ap)
+static void
+freeblk(void *ap)
 {
   Header *bp, *p;
 
@@ -56,12 +57,12 @@ morecore(uint nu)
     return 0;
   hp = (Header*)p;
   hp->s.size = nu;
-  free((void*)(hp + 1));
+  freeblk((void*)(hp + 1));
   return freep;
 }
 
-void*
-malloc(uint nbytes)
+static void*
+allocblk(uint nbytes)
 {
   Header *p, *prevp;
   uint nunits;
@@ -88,3 +89,22 @@ malloc(uint nbytes)
         return 0;
   }
 }
+
+void
+free(void *ap)
+{
+  mutex_lock(&lock);
+  freeblk(ap);
+  mutex_unlock(&lock);
+}
+
+void*
+malloc(uint nbytes)
+{
+  void *p;
+
+  mutex_lock(&lock);
+  p = allocblk(nbytes);
+  mutex_unlock(&lock);
+  return p;
+}
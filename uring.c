@@ -0,0 +1,310 @@
+// Submission and completion rings.
+//
+// uring_setup() takes a page of the process (from shmat() or
+// sbrk()) to hold a submission and a completion ring (uring.h),
+// and starts NURINGWORKER kernel threads for it.  uring_enter()
+// then takes any number of queued system calls in one trap.
+// Opens and closes change the process's file table, so they are
+// done right there.  Reads, writes and fstats take a reference
+// to their file and go on a queue for the kernel threads, which
+// run them on the process's page table, several at a time while
+// the process goes on computing, and post the results to the
+// completion ring.  The ring goes away when the process exits or
+// execs.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "memlayout.h"
+#include "mmu.h"
+#include "proc.h"
+#include "spinlock.h"
+#include "sleeplock.h"
+#include "fs.h"
+#include "file.h"
+#include "stat.h"
+#include "uio.h"
+#include "uring.h"
+
+struct uwork {
+  struct uring_sqe sqe;
+  struct file *f;
+};
+
+struct kring {
+  struct proc *owner;           // 0 if the entry is free
+  struct uring *ring;           // the shared page
+  struct proc *worker[NURINGWORKER];
+  int nworker;                  // worker threads still running
+  int dying;                    // the owner is done with it
+  uint inflight;                // taken from sq, not yet in cq
+  uint qhead, qtail;            // work not started yet
+  struct uwork q[URING_ENTRIES];
+};
+
+static struct {
+  struct spinlock lock;
+  struct kring kr[NURING];
+} uring;
+
+void
+uringinit(void)
+{
+  initlock(&uring.lock, "uring");
+}
+
+// The live ring of p, or 0.  Caller holds uring.lock.
+static struct kring*
+findring(struct proc *p)
+{
+  struct kring *k;
+
+  for(k = uring.kr; k < &uring.kr[NURING]; k++)
+    if(k->owner == p && !k->dying)
+      return k;
+  return 0;
+}
+
+// Post a completion.  Caller holds uring.lock.
+static void
+complete(struct kring *k, uint user_data, int res)
+{
+  struct uring_cqe *c;
+
+  c = &k->ring->cq[k->ring->cq_tail % URING_ENTRIES];
+  c->user_data = user_data;
+  c->res = res;
+  __sync_synchronize();  // the entry before the index
+  k->ring->cq_tail++;
+  wakeup(k);
+}
+
+// Run queued work in a kernel thread.  The process may have
+// let go of the buffer since uring_enter() checked it, so check
+// it again, which pins it until the worker calls uvmunpin().
+static int
+uringdo(struct uwork *w)
+{
+  struct iovec iov;
+  uint off = w->sqe.off;
+
+  if(checkptr((uint)w->sqe.addr,
+              w->sqe.op == UR_FSTAT ? sizeof(struct stat) : w->sqe.len) < 0)
+    return -1;
+  iov.iov_base = w->sqe.addr;
+  iov.iov_len = w->sqe.len;
+  switch(w->sqe.op){
+  case UR_READ:
+    return filereadv(w->f, &iov, 1, w->sqe.off >= 0 ? &off : 0);
+  case UR_WRITE:
+    return filewritev(w->f, &iov, 1, w->sqe.off >= 0 ? &off : 0);
+  case UR_FSTAT:
+    return filestat(w->f, w->sqe.addr);
+  }
+  return -1;
+}
+
+// Body of the kernel threads.
+static void
+uringworker(void)
+{
+  struct kring *k;
+  struct uwork w;
+  int i, res;
+
+  acquire(&uring.lock);
+  for(k = uring.kr; k < &uring.kr[NURING]; k++)
+    for(i = 0; i < NURINGWORKER; i++)
+      if(k->worker[i] == myproc())
+        goto found;
+  panic("uringworker");
+
+found:
+  for(;;){
+    while(k->qhead == k->qtail && !k->dying)
+      sleep(&k->qtail, &uring.lock);
+    if(k->qhead == k->qtail)
+      break;
+    w = k->q[k->qhead++ % URING_ENTRIES];
+    release(&uring.lock);
+    res = k->dying ? -1 : uringdo(&w);
+    uvmunpin();
+    fileclose(w.f);
+    acquire(&uring.lock);
+    k->inflight--;
+    if(!k->dying)
+      complete(k, w.sqe.user_data, res);
+  }
+
+  // The owner is gone and the queue is drained.
+  k->worker[i] = 0;
+  if(--k->nworker == 0){
+    kfree((char*)k->ring);
+    k->owner = 0;
+  }
+  release(&uring.lock);
+  exit();
+}
+
+// Set up the rings of the current process in the page at r.
+int
+uringsetup(struct uring *r)
+{
+  struct proc *p = myproc();
+  struct kring *k;
+  char *ka;
+  int i;
+
+  if((uint)r % PGSIZE != 0 || checkptr((uint)r, sizeof(*r)) < 0)
+    return -1;
+  if((ka = uva2ka(p->pgdir, (char*)r)) == 0)
+    return -1;
+
+  acquire(&uring.lock);
+  if(findring(p) != 0){
+    release(&uring.lock);
+    return -1;
+  }
+  for(k = uring.kr; k < &uring.kr[NURING] && k->owner != 0; k++)
+    ;
+  if(k == &uring.kr[NURING]){
+    release(&uring.lock);
+    return -1;
+  }
+
+  // The page stays the kernel's to write even if the
+  // process lets go of it.
+  kref(ka);
+  k->ring = (struct uring*)ka;
+  k->ring->sq_head = k->ring->sq_tail = 0;
+  k->ring->cq_head = k->ring->cq_tail = 0;
+  k->owner = p;
+  k->dying = 0;
+  k->inflight = 0;
+  k->qhead = k->qtail = 0;
+  k->nworker = 0;
+  for(i = 0; i < NURINGWORKER; i++)
+    if((k->worker[i] = kthread("uring", uringworker, p->pgdir)) != 0)
+      k->nworker++;
+  if(k->nworker == 0){
+    kfree(ka);
+    k->owner = 0;
+    release(&uring.lock);
+    return -1;
+  }
+  release(&uring.lock);
+  return 0;
+}
+
+// Check submission sqe and return a reference to its file if
+// it is for the kernel threads.  Otherwise return 0 with its
+// result in *res: opens and closes are done here, in the
+// process, as they change its file table.
+static struct file*
+uringprep(struct uring_sqe *sqe, int *res)
+{
+  char path[MAXPATH];
+
+  *res = -1;
+  switch(sqe->op){
+  case UR_OPEN:
+    if(fetchstr((uint)sqe->addr, path, MAXPATH) >= 0)
+      *res = fdopen(path, sqe->len);
+    return 0;
+  case UR_CLOSE:
+    *res = fdclose(sqe->fd);
+    return 0;
+  case UR_READ:
+  case UR_WRITE:
+    if((int)sqe->len < 0 || checkptr((uint)sqe->addr, sqe->len) < 0)
+      return 0;
+    break;
+  case UR_FSTAT:
+    if(checkptr((uint)sqe->addr, sizeof(struct stat)) < 0)
+      return 0;
+    break;
+  default:
+    return 0;
+  }
+  return fdget(myproc()->fdt, sqe->fd);
+}
+
+// Take up to n submissions, then wait until there are at least
+// min completions to consume, or nothing left in flight.
+// Returns the number taken, which is short if the submission
+// ring runs empty, or if the completion ring would have no room
+// for the results.  The indexes in the shared page are the
+// process's to scribble on, so the limits that keep the kernel
+// safe come from inflight and the queue; the completion ring is
+// only checked so that results are not lost.
+int
+uringenter(int n, int min)
+{
+  struct proc *p = myproc();
+  struct uring_sqe sqe;
+  struct kring *k;
+  struct uring *r;
+  struct file *f;
+  int i, res;
+
+  acquire(&uring.lock);
+  if((k = findring(p)) == 0){
+    release(&uring.lock);
+    return -1;
+  }
+  r = k->ring;
+  for(i = 0; i < n; i++){
+    if(k->inflight >= URING_ENTRIES || k->qtail - k->qhead >= URING_ENTRIES)
+      break;
+    if(r->sq_head == r->sq_tail)
+      break;
+    if(r->cq_tail - r->cq_head + k->inflight >= URING_ENTRIES)
+      break;
+    // Copy it: the process could change it under us.
+    sqe = r->sq[r->sq_head % URING_ENTRIES];
+    r->sq_head++;
+    k->inflight++;
+    release(&uring.lock);
+    f = uringprep(&sqe, &res);
+    acquire(&uring.lock);
+    if(f){
+      k->q[k->qtail % URING_ENTRIES].sqe = sqe;
+      k->q[k->qtail % URING_ENTRIES].f = f;
+      k->qtail++;
+      wakeup(&k->qtail);
+    } else {
+      k->inflight--;
+      complete(k, sqe.user_data, res);
+    }
+  }
+
+  if(min < 0)
+    min = 0;
+  if(min > URING_ENTRIES)
+    min = URING_ENTRIES;
+  while(k->inflight > 0 && r->cq_tail - r->cq_head < (uint)min && !p->killed)
+    sleep(k, &uring.lock);
+  release(&uring.lock);
+  return i;
+}
+
+// Tear down the rings of p, which is exiting or exec'ing.  The
+// kernel threads finish what they are doing, drop the rest and
+// exit; they are killed so that they do not wait on a pipe or
+// the console forever.
+void
+uringexit(struct proc *p)
+{
+  struct kring *k;
+  int i;
+
+  acquire(&uring.lock);
+  if((k = findring(p)) != 0){
+    k->dying = 1;
+    for(i = 0; i < NURINGWORKER; i++)
+      if(k->worker[i])
+        kill(k->worker[i]->pid);
+    wakeup(&k->qtail);
+  }
+  release(&uring.lock);
+}
@@ -0,0 +1,37 @@
+// Submission and completion rings (uring.c).
+#define URING_ENTRIES 64  // entries in each ring, a power of 2
+
+// Operations.
+#define UR_READ  1  // read(fd, addr, len), or pread at off
+#define UR_WRITE 2  // write(fd, addr, len), or pwrite at off
+#define UR_OPEN  3  // open(addr, len as the mode)
+#define UR_CLOSE 4  // close(fd)
+#define UR_FSTAT 5  // fstat(fd, addr)
+
+struct uring_sqe {
+	int op;
+	int fd;
+	void *addr;       // buffer, path or struct stat
+	uint len;
+	int off;          // file offset, or -1 for the file's own
+	uint user_data;   // handed back in the completion
+};
+
+struct uring_cqe {
+	uint user_data;
+	int res;          // what the system call would have returned
+};
+
+// The page that uring_setup maps.  The process fills sq[] and
+// advances sq_tail; uring_enter consumes entries up to it.  The
+// kernel fills cq[] and advances cq_tail; the process consumes
+// entries and advances cq_head.  Indexes run freely and wrap
+// modulo URING_ENTRIES.
+struct uring {
+	volatile uint sq_head;
+	volatile uint sq_tail;
+	volatile uint cq_head;
+	volatile uint cq_tail;
+	struct uring_sqe sq[URING_ENTRIES];
+	struct uring_cqe cq[URING_ENTRIES];
+};
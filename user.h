@@ -1,12 +1,24 @@
 struct stat;
 struct rtcdate;
 struct pinfo;
+struct lockinfo;
+struct profsample;
+struct schedevent;
+struct iostat;
+struct schedparam;
+struct rusage;
+struct sysstat;
+struct iovec;
+struct uring;
+struct pollfd;
+struct spawnact;
 
 // system calls
 int fork(void);
 int exit(void) __attribute__((noreturn));
 int wait(void);
 int waitx(int *, int *);
+int wait4(int, struct rusage *);
 int pipe(int*);
 int write(int, const void*, int);
 int read(int, void*, int);
@@ -27,6 +39,36 @@ int sleep(int);
 int uptime(void);
 int set_priority(int, int);
 int get_pinfos(struct pinfo *);
+int get_lockstat(struct lockinfo *, int, int);
+int profctl(int);
+int profread(struct profsample *, int);
+int tracectl(int);
+int traceread(struct schedevent *, int);
+int getiostat(struct iostat *, int);
+int sched_deadline(int, int, int);
+int schedctl(int, struct schedparam *);
+int sched_setaffinity(int, uint);
+int sched_getaffinity(int);
+int cpustat(struct sysstat *);
+int clone(void (*)(void *, void *), void *, void *, void *);
+int join(void **);
+int futex_wait(volatile uint *, uint, int);
+int futex_wake(volatile uint *, int);
+int shmget(int, uint);
+void *shmat(int);
+int shmdt(void *);
+void *mmap(void *, uint, int, int, int, uint);
+int munmap(void *, uint);
+int pread(int, void *, int, uint);
+int pwrite(int, const void *, int, uint);
+int readv(int, const struct iovec *, int);
+int writev(int, const struct iovec *, int);
+int copy_file_range(int, uint *, int, uint *, int, int);
+int uring_setup(struct uring *);
+int uring_enter(int, int);
+int poll(struct pollfd *, int, int);
+int fcntl(int, int, int);
+int spawn(char *, char **, struct spawnact *, int);
 
 // ulib.c
 int stat(const char*, struct stat*);
@@ -41,3 +83,27 @@ void* memset(void*, int, uint);
 void* malloc(uint);
 void free(void*);
 int atoi(const char*);
+int thread_create(void (*)(void *), void *);
+int thread_join(void);
+
+// ulib.c: locks on futexes.  All start out zeroed, except that
+// a semaphore's count is set with sem_init.
+struct mutex {
+	volatile uint val;    // 0 free, 1 held, 2 held and maybe waited for
+};
+struct cond {
+	volatile uint seq;    // bumped by every signal
+};
+struct sem {
+	volatile uint count;
+	volatile uint waiters;
+};
+void mutex_lock(struct mutex *);
+int mutex_trylock(struct mutex *);
+void mutex_unlock(struct mutex *);
+int cond_wait(struct cond *, struct mutex *, int);
+void cond_signal(struct cond *);
+void cond_broadcast(struct cond *);
+void sem_init(struct sem *, uint);
+void sem_wait(struct sem *);
+void sem_post(struct sem *);
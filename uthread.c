@@ -0,0 +1,41 @@
+// User-level thread library on top of clone() and join().
+
+#include "types.h"
+#include "user.h"
+#include "mmu.h"
+
+// clone() starts fn on a PGSIZE stack we allocate; thread_start
+// lets fn return instead of having to call exit().
+static void
+thread_start(void *fn, void *arg)
+{
+  ((void (*)(void*))fn)(arg);
+  exit();
+}
+
+// Run fn(arg) in a new thread.  Returns its pid, or -1.
+int
+thread_create(void (*fn)(void*), void *arg)
+{
+  void *stack;
+  int pid;
+
+  if((stack = malloc(PGSIZE)) == 0)
+    return -1;
+  if((pid = clone(thread_start, (void*)fn, arg, stack)) < 0)
+    free(stack);
+  return pid;
+}
+
+// Wait for a thread to finish and free its stack.
+// Returns its pid, or -1 if there are no threads.
+int
+thread_join(void)
+{
+  void *stack;
+  int pid;
+
+  if((pid = join(&stack)) >= 0)
+    free(stack);
+  return pid;
+}
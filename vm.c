@@ -6,6 +6,7 @@
 #include "mmu.h"
 #include "proc.h"
 #include "elf.h"
+#include "traps.h"
 
 extern char data[];  // defined by kernel.ld
 pde_t *kpgdir;  // for use in scheduler()
@@ -32,7 +33,7 @@ seginit(void)
 // Return the address of the PTE in page table pgdir
 // that corresponds to virtual address va.  If alloc!=0,
 // create any required page table pages.
-static pte_t *
+pte_t *
 walkpgdir(pde_t *pgdir, const void *va, int alloc)
 {
   pde_t *pde;
@@ -57,7 +58,7 @@ walkpgdir(pde_t *pgdir, const void *va, int alloc)
 // Create PTEs for virtual addresses starting at va that refer to
 // physical addresses starting at pa. va and size might not
 // be page-aligned.
-static int
+int
 mappages(pde_t *pgdir, void *va, uint size, uint pa, int perm)
 {
   char *a, *last;
@@ -177,6 +178,36 @@ switchuvm(struct proc *p)
   popcli();
 }
 
+// Make every CPU running on pgdir drop its cached translations
+// and wait until they all have.  The other CPUs only take the
+// IPI with interrupts on, so the caller must not hold a spinlock.
+void
+tlbshootdown(pde_t *pgdir)
+{
+  struct cpu *c;
+  struct proc *p;
+
+  // The PTE updates must be visible before we look at c->proc:
+  // a CPU that switches to pgdir after that loads %cr3 anyway.
+  __sync_synchronize();
+  pushcli();
+  for(c = cpus; c < cpus+ncpu; c++){
+    p = c->proc;
+    if(p == 0 || p->pgdir != pgdir)
+      continue;
+    if(c == mycpu())
+      lcr3(V2P(pgdir));
+    else {
+      c->tlbflush = 1;
+      lapicipi(c->apicid, T_IRQ0 + IRQ_TLB);
+    }
+  }
+  popcli();
+  for(c = cpus; c < cpus+ncpu; c++)
+    while(c->tlbflush)
+      ;
+}
+
 // Load the initcode into address 0 of pgdir.
 // sz must be less than a page.
 void
@@ -224,7 +255,7 @@ allocuvm(pde_t *pgdir, uint oldsz, uint newsz)
   char *mem;
   uint a;
 
-  if(newsz >= KERNBASE)
+  if(newsz > MMAPBASE)
     return 0;
   if(newsz < oldsz)
     return oldsz;
@@ -271,15 +302,78 @@ deallocuvm(pde_t *pgdir, uint oldsz, uint newsz)
       if(pa == 0)
         panic("kfree");
       char *v = P2V(pa);
-      kfree(v);
+      if((*pte & PTE_SHARED) == 0)
+        kfree(v);
+      *pte = 0;
+    }
+  }
+  return newsz;
+}
+
+// Like deallocuvm, but for a page table that other CPUs may be
+// using through threads: unmap the pages, shoot down the stale
+// TLB entries, and only then free the pages.  Must not hold any
+// spinlock (see tlbshootdown).
+int
+shrinkuvm(pde_t *pgdir, uint oldsz, uint newsz)
+{
+  pte_t *pte;
+  uint a;
+
+  if(newsz >= oldsz)
+    return oldsz;
+
+  // Leave the addresses in the PTEs to find the pages again.
+  for(a = PGROUNDUP(newsz); a < oldsz; a += PGSIZE){
+    pte = walkpgdir(pgdir, (char*)a, 0);
+    if(!pte)
+      a = PGADDR(PDX(a) + 1, 0, 0) - PGSIZE;
+    else
+      *pte &= ~PTE_P;
+  }
+  tlbshootdown(pgdir);
+  for(a = PGROUNDUP(newsz); a < oldsz; a += PGSIZE){
+    pte = walkpgdir(pgdir, (char*)a, 0);
+    if(!pte)
+      a = PGADDR(PDX(a) + 1, 0, 0) - PGSIZE;
+    else if(PTE_ADDR(*pte) != 0){
+      kfree(P2V(PTE_ADDR(*pte)));
       *pte = 0;
     }
   }
   return newsz;
 }
 
+// Map the n shared memory pages pages[] at va in pgdir, marked
+// PTE_SHARED so that deallocuvm and freevm leave them alone.
+int
+shmmap(pde_t *pgdir, uint va, char **pages, int n)
+{
+  int i;
+
+  for(i = 0; i < n; i++)
+    if(mappages(pgdir, (char*)va + i*PGSIZE, PGSIZE, V2P(pages[i]),
+                PTE_W|PTE_U|PTE_SHARED) < 0)
+      return -1;
+  return 0;
+}
+
+// Remove the shared memory mappings of n pages at va.
+void
+shmunmap(pde_t *pgdir, uint va, int n)
+{
+  pte_t *pte;
+  int i;
+
+  for(i = 0; i < n; i++)
+    if((pte = walkpgdir(pgdir, (char*)va + i*PGSIZE, 0)) != 0 &&
+       (*pte & PTE_SHARED))
+      *pte = 0;
+}
+
 // Free a page table and all the physical memory pages
-// in the user part.
+// in the user part.  Writes back file mappings, so it may
+// sleep and must not be called inside a transaction.
 void
 freevm(pde_t *pgdir)
 {
@@ -287,6 +381,8 @@ freevm(pde_t *pgdir)
 
   if(pgdir == 0)
     panic("freevm: no pgdir");
+  shmfree(pgdir);
+  mmapfree(pgdir);
   deallocuvm(pgdir, KERNBASE, 0);
   for(i = 0; i < NPDENTRIES; i++){
     if(pgdir[i] & PTE_P){
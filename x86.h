@@ -117,6 +117,33 @@ sti(void)
   asm volatile("sti");
 }
 
+// Index of the most significant set bit of x, or 0 if x is 0.
+// Used to bucket cycle counts into log2 histograms.
+static inline uint
+msb64(uint64 x)
+{
+  uint r, hi, lo;
+
+  hi = x >> 32;
+  lo = x;
+  if(hi){
+    asm("bsrl %1,%0" : "=r" (r) : "rm" (hi));
+    return r + 32;
+  }
+  if(lo){
+    asm("bsrl %1,%0" : "=r" (r) : "rm" (lo));
+    return r;
+  }
+  return 0;
+}
+
+// Spin-wait hint.
+static inline void
+pause(void)
+{
+  asm volatile("pause");
+}
+
 static inline uint
 xchg(volatile uint *addr, uint newval)
 {
@@ -130,6 +157,15 @@ xchg(volatile uint *addr, uint newval)
   return result;
 }
 
+// Read the time-stamp counter.
+static inline uint64
+rdtsc(void)
+{
+  uint lo, hi;
+  asm volatile("rdtsc" : "=a" (lo), "=d" (hi));
+  return ((uint64)hi << 32) | lo;
+}
+
 static inline uint
 rcr2(void)
 {
@@ -144,6 +180,14 @@ lcr3(uint val)
   asm volatile("movl %0,%%cr3" : : "r" (val));
 }
 
+static inline uint
+rcr3(void)
+{
+  uint val;
+  asm volatile("movl %%cr3,%0" : "=r" (val));
+  return val;
+}
+
 //PAGEBREAK: 36
 // Layout of the trap frame built on the stack by the
 // hardware and by trapasm.S, and passed to trap().